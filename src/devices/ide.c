@@ -47,8 +47,11 @@
    Many more are defined but this is the small subset that we
    use. */
 #define CMD_IDENTIFY_DEVICE 0xec    /* IDENTIFY DEVICE. */
-#define CMD_READ_SECTOR_RETRY 0x20  /* READ SECTOR with retries. */
-#define CMD_WRITE_SECTOR_RETRY 0x30 /* WRITE SECTOR with retries. */
+#define CMD_READ_SECTOR_RETRY 0x20  /* READ SECTOR(S) with retries. */
+#define CMD_WRITE_SECTOR_RETRY 0x30 /* WRITE SECTOR(S) with retries. */
+
+/* Most sectors a single READ or WRITE SECTOR(S) command transfers. */
+#define MAX_SECTORS_PER_COMMAND 256
 
 /* An ATA device. */
 struct ata_disk
@@ -85,7 +88,7 @@ static void reset_channel(struct channel *);
 static bool check_device_type(struct ata_disk *);
 static void identify_ata_device(struct ata_disk *);
 
-static void select_sector(struct ata_disk *, block_sector_t);
+static void select_sector(struct ata_disk *, block_sector_t, size_t cnt);
 static void issue_pio_command(struct channel *, uint8_t command);
 static void input_sector(struct channel *, void *);
 static void output_sector(struct channel *, const void *);
@@ -333,62 +336,118 @@ descramble_ata_string(char *string, int size)
     return string;
 }
 
-/* Reads sector SEC_NO from disk D into BUFFER, which must have
-   room for BLOCK_SECTOR_SIZE bytes.
+/* Reads CNT sectors starting at SEC_NO from disk D into BUFFER,
+   which must have room for CNT * BLOCK_SECTOR_SIZE bytes.  Issues
+   one command per MAX_SECTORS_PER_COMMAND sectors.
    Internally synchronizes accesses to disks, so external
    per-disk locking is unneeded. */
 static void
-ide_read(void *d_, block_sector_t sec_no, void *buffer)
+ide_read_multiple(void *d_, block_sector_t sec_no, size_t cnt, void *buffer_)
 {
     struct ata_disk *d = d_;
     struct channel *c = d->channel;
+    uint8_t *buffer = buffer_;
     lock_acquire(&c->lock);
-    select_sector(d, sec_no);
-    issue_pio_command(c, CMD_READ_SECTOR_RETRY);
-    sema_down(&c->completion_wait);
-    if (!wait_while_busy(d))
-        PANIC("%s: disk read failed, sector=%" PRDSNu, d->name, sec_no);
-    input_sector(c, buffer);
+    while (cnt > 0)
+    {
+        size_t chunk = cnt < MAX_SECTORS_PER_COMMAND ? cnt : MAX_SECTORS_PER_COMMAND;
+        size_t i;
+
+        select_sector(d, sec_no, chunk);
+        issue_pio_command(c, CMD_READ_SECTOR_RETRY);
+        for (i = 0; i < chunk; i++)
+        {
+            /* The disk interrupts once per sector, when the
+               sector is ready to be transferred. */
+            sema_down(&c->completion_wait);
+            if (!wait_while_busy(d))
+                PANIC("%s: disk read failed, sector=%" PRDSNu,
+                      d->name, sec_no + i);
+            input_sector(c, buffer);
+            buffer += BLOCK_SECTOR_SIZE;
+        }
+        sec_no += chunk;
+        cnt -= chunk;
+    }
     lock_release(&c->lock);
 }
 
-/* Write sector SEC_NO to disk D from BUFFER, which must contain
-   BLOCK_SECTOR_SIZE bytes.  Returns after the disk has
-   acknowledged receiving the data.
+/* Writes CNT sectors starting at SEC_NO to disk D from BUFFER,
+   which must contain CNT * BLOCK_SECTOR_SIZE bytes.  Returns
+   after the disk has acknowledged receiving the data.  Issues
+   one command per MAX_SECTORS_PER_COMMAND sectors.
    Internally synchronizes accesses to disks, so external
    per-disk locking is unneeded. */
 static void
-ide_write(void *d_, block_sector_t sec_no, const void *buffer)
+ide_write_multiple(void *d_, block_sector_t sec_no, size_t cnt,
+                   const void *buffer_)
 {
     struct ata_disk *d = d_;
     struct channel *c = d->channel;
+    const uint8_t *buffer = buffer_;
     lock_acquire(&c->lock);
-    select_sector(d, sec_no);
-    issue_pio_command(c, CMD_WRITE_SECTOR_RETRY);
-    if (!wait_while_busy(d))
-        PANIC("%s: disk write failed, sector=%" PRDSNu, d->name, sec_no);
-    output_sector(c, buffer);
-    sema_down(&c->completion_wait);
+    while (cnt > 0)
+    {
+        size_t chunk = cnt < MAX_SECTORS_PER_COMMAND ? cnt : MAX_SECTORS_PER_COMMAND;
+        size_t i;
+
+        select_sector(d, sec_no, chunk);
+        issue_pio_command(c, CMD_WRITE_SECTOR_RETRY);
+        for (i = 0; i < chunk; i++)
+        {
+            /* The disk interrupts once per sector, after it has
+               accepted the sector. */
+            if (!wait_while_busy(d))
+                PANIC("%s: disk write failed, sector=%" PRDSNu,
+                      d->name, sec_no + i);
+            output_sector(c, buffer);
+            buffer += BLOCK_SECTOR_SIZE;
+            sema_down(&c->completion_wait);
+        }
+        sec_no += chunk;
+        cnt -= chunk;
+    }
     lock_release(&c->lock);
 }
 
+/* Reads sector SEC_NO from disk D into BUFFER, which must have
+   room for BLOCK_SECTOR_SIZE bytes. */
+static void
+ide_read(void *d, block_sector_t sec_no, void *buffer)
+{
+    ide_read_multiple(d, sec_no, 1, buffer);
+}
+
+/* Write sector SEC_NO to disk D from BUFFER, which must contain
+   BLOCK_SECTOR_SIZE bytes.  Returns after the disk has
+   acknowledged receiving the data. */
+static void
+ide_write(void *d, block_sector_t sec_no, const void *buffer)
+{
+    ide_write_multiple(d, sec_no, 1, buffer);
+}
+
 static struct block_operations ide_operations =
     {
         ide_read,
-        ide_write};
+        ide_write,
+        ide_read_multiple,
+        ide_write_multiple};
 
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
+   writes SEC_NO and the count CNT, which must be between 1 and
+   MAX_SECTORS_PER_COMMAND, to the disk's sector selection
+   registers.  (We use LBA mode.) */
 static void
-select_sector(struct ata_disk *d, block_sector_t sec_no)
+select_sector(struct ata_disk *d, block_sector_t sec_no, size_t cnt)
 {
     struct channel *c = d->channel;
 
     ASSERT(sec_no < (1UL << 28));
+    ASSERT(cnt > 0 && cnt <= MAX_SECTORS_PER_COMMAND);
 
     select_device_wait(d);
-    outb(reg_nsect(c), 1);
+    outb(reg_nsect(c), cnt); /* 256 is written as 0. */
     outb(reg_lbal(c), sec_no);
     outb(reg_lbam(c), sec_no >> 8);
     outb(reg_lbah(c), (sec_no >> 16));
@@ -11,9 +11,6 @@
 #define PIT_PORT_CONTROL 0x43                        /* Control port. */
 #define PIT_PORT_COUNTER(CHANNEL) (0x40 + (CHANNEL)) /* Counter port. */
 
-/* PIT cycles per second. */
-#define PIT_HZ 1193180
-
 /* Configure the given CHANNEL in the PIT.  In a PC, the PIT's
    three output channels are hooked up like this:
 
@@ -80,3 +77,43 @@ void pit_configure_channel(int channel, int mode, int frequency)
     outb(PIT_PORT_COUNTER(channel), count >> 8);
     intr_set_level(old_level);
 }
+
+/* Configures the given CHANNEL in mode 0, "interrupt on
+   terminal count": the channel's output goes high once, COUNT
+   PIT cycles from now, and stays high until the channel is
+   reprogrammed.  Hooked up to interrupt line 0, this gives a
+   single timer interrupt.  A COUNT of 0 is treated as 65536,
+   about 55 ms. */
+void pit_configure_oneshot(int channel, uint16_t count)
+{
+    enum intr_level old_level;
+
+    ASSERT(channel == 0 || channel == 2);
+
+    old_level = intr_disable();
+    outb(PIT_PORT_CONTROL, (channel << 6) | 0x30);
+    outb(PIT_PORT_COUNTER(channel), count);
+    outb(PIT_PORT_COUNTER(channel), count >> 8);
+    intr_set_level(old_level);
+}
+
+/* Returns the current value of the given CHANNEL's counter,
+   which counts down from the value loaded by
+   pit_configure_channel() once per PIT cycle.  The counter is
+   latched first, so that both bytes come from the same
+   instant. */
+uint16_t pit_read_counter(int channel)
+{
+    uint16_t count;
+    enum intr_level old_level;
+
+    ASSERT(channel == 0 || channel == 2);
+
+    old_level = intr_disable();
+    outb(PIT_PORT_CONTROL, channel << 6);
+    count = inb(PIT_PORT_COUNTER(channel));
+    count |= inb(PIT_PORT_COUNTER(channel)) << 8;
+    intr_set_level(old_level);
+
+    return count;
+}
@@ -5,6 +5,8 @@
 #include "devices/serial.h"
 #include "devices/timer.h"
 #include "threads/io.h"
+#include "threads/palloc.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
@@ -13,6 +15,10 @@
 #include "devices/block.h"
 #include "filesys/filesys.h"
 #endif
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/swap.h"
+#endif
 
 /* Keyboard control register port. */
 #define CONTROL_REG 0x64
@@ -130,6 +136,8 @@ print_stats(void)
 {
     timer_print_stats();
     thread_print_stats();
+    palloc_print_stats();
+    slab_print_stats();
 #ifdef FILESYS
     block_print_stats();
 #endif
@@ -138,4 +146,8 @@ print_stats(void)
 #ifdef USERPROG
     exception_print_stats();
 #endif
+#ifdef VM
+    frame_print_stats();
+    swap_print_stats();
+#endif
 }
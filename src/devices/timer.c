@@ -4,9 +4,11 @@
 #include <round.h>
 #include <stdio.h>
 #include "devices/pit.h"
+#include "threads/cpugroup.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
 #include <list.h>
 
 /* See [8254] for hardware details of the 8254 timer chip. */
@@ -18,28 +20,97 @@
 #error TIMER_FREQ <= 1000 recommended
 #endif
 
+/* Number of PIT cycles in one timer tick. */
+#define TICK_PIT_CYCLES ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
+/* Sleeping threads, kept in a hierarchical timing wheel.
+
+   Level 0 has one slot per tick for the next WHEEL0_SLOTS ticks.
+   Each slot of level L > 0 covers as many ticks as all of level
+   L - 1, so that a sleeper whose wake_ticks is D ticks away goes
+   into the lowest level that reaches D, in constant time.  When
+   level 0 wraps around, the next slot of level 1 is "cascaded"
+   into level 0 by re-inserting its threads, and so on up the
+   levels.  Each thread is thus moved at most once per level, and
+   timer_interrupt() touches only the slot of the current tick.
+   Sleepers too far away for the top level are parked in its
+   farthest slot and re-inserted when that slot cascades.
+
+   Within a slot, threads are kept in FIFO order through their
+   `elem' members. */
+#define WHEEL0_BITS 8
+#define WHEELN_BITS 6
+#define WHEEL0_SLOTS (1 << WHEEL0_BITS)
+#define WHEELN_SLOTS (1 << WHEELN_BITS)
+#define WHEEL_LEVELS 4
+#define WHEEL_BITS(LEVEL) (WHEEL0_BITS + ((LEVEL)-1) * WHEELN_BITS)
+#define WHEEL_MAX_DELTA (((int64_t)1 << WHEEL_BITS(WHEEL_LEVELS)) - 1)
+
+static struct list wheel0[WHEEL0_SLOTS];
+static struct list wheeln[WHEEL_LEVELS - 1][WHEELN_SLOTS];
+
+/* Next tick whose level 0 slot timer_interrupt() will expire.
+   Everything before it has already been woken up. */
+static int64_t wheel_ticks;
+
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* If false (default), take a timer interrupt every tick.
+   If true, stop the periodic tick while the CPU is idle.
+   Controlled by kernel command-line option "-tickless". */
+bool timer_tickless;
+
+/* Tickless idle.  While the idle thread halts and no sleeper
+   is due, the 8254 is switched to one-shot mode to interrupt
+   only at the tick of the next event, at most ONESHOT_MAX_TICKS
+   away.  A count is only 16 bits wide, about 55 ms, so a longer
+   interval is counted down as a chain of one-shots.  The
+   interrupts between them just arm the next one, without any
+   tick accounting, so an idle CPU takes about PIT_HZ / 65536,
+   i.e. 18, timer interrupts per second instead of TIMER_FREQ. */
+#define ONESHOT_MAX_TICKS WHEEL0_SLOTS
+#define ONESHOT_MAX_COUNT 65535
+static bool oneshot;           /* 8254 in one-shot mode? */
+static int64_t oneshot_end;    /* Tick the last one-shot ends. */
+static unsigned oneshot_count; /* PIT cycles in the armed one-shot. */
+static int64_t oneshot_rest;   /* PIT cycles in the ones after it. */
+
+/* Number of timer interrupts taken. */
+static long long timer_intr_cnt;
+
 static intr_handler_func timer_interrupt;
 static bool too_many_loops(unsigned loops);
 static void busy_wait(int64_t loops);
 static void real_time_sleep(int64_t num, int32_t denom);
 static void real_time_delay(int64_t num, int32_t denom);
-static list_less_func less_wake_ticks;
+static void wheel_insert(struct thread *);
+static void wheel_cascade(int level);
+static void wheel_expire(void);
+static int64_t wheel_next_event(int64_t limit);
+static void oneshot_arm(int64_t cycles);
+static unsigned oneshot_overshoot(unsigned left);
+static void oneshot_catch_up(int64_t cnt);
+static int64_t apply_slack(int64_t wake_ticks, int64_t slack);
 
 /* Sets up the timer to interrupt TIMER_FREQ times per second,
    registers the corresponding interrupt, and initializes the
-   sleep list. */
+   timing wheel. */
 void timer_init(void)
 {
+    int i, j;
+
     pit_configure_channel(0, 2, TIMER_FREQ);
     intr_register_ext(0x20, timer_interrupt, "8254 Timer");
-    list_init(get_sleep_list());
+    for (i = 0; i < WHEEL0_SLOTS; i++)
+        list_init(&wheel0[i]);
+    for (i = 0; i < WHEEL_LEVELS - 1; i++)
+        for (j = 0; j < WHEELN_SLOTS; j++)
+            list_init(&wheeln[i][j]);
 }
 
 /* Calibrates loops_per_tick, used to implement brief delays. */
@@ -86,10 +157,48 @@ timer_elapsed(int64_t then)
     return timer_ticks() - then;
 }
 
+/* Returns the approximate number of nanoseconds since the OS
+   booted.  The fraction of the current tick is read from the
+   8254's counter, so the resolution is one PIT cycle (about
+   838 ns) rather than one timer tick.  Meant for measuring
+   short intervals, such as time spent in interrupt handlers.
+
+   The counter counts down the PIT cycles left until the next
+   tick boundary in periodic mode.  In one-shot mode, it counts
+   down the armed one-shot, which the rest of the chain follows
+   until tick oneshot_end.  Once it has wrapped around but the
+   interrupt is still pending, it reads as if time went
+   backward, so the result never goes below the previous one. */
+int64_t
+timer_ns(void)
+{
+    static int64_t last_ns;
+    enum intr_level old_level = intr_disable();
+    int64_t end = oneshot ? oneshot_end : ticks + 1;
+    int64_t left = pit_read_counter(0) + (oneshot ? oneshot_rest : 0);
+    int64_t ns = end * (1000000000 / TIMER_FREQ) - left * 1000000000 / PIT_HZ;
+
+    if (ns < last_ns)
+        ns = last_ns;
+    last_ns = ns;
+    intr_set_level(old_level);
+    return ns;
+}
+
 /* Sleeps for approximately TICKS timer ticks. The current
    thread is put to sleep and wakes up later in
    timer_interrupt(). Interrupts must be turned on. */
 void timer_sleep(int64_t ticks)
+{
+    timer_sleep_slack(ticks, 0);
+}
+
+/* Sleeps for at least TICKS timer ticks, but allows the wakeup
+   to be deferred by up to SLACK more ticks.  The wakeup is moved
+   to the tick in that window that is the most "round", so that
+   threads whose windows overlap tend to be woken up together in
+   a single tick.  Interrupts must be turned on. */
+void timer_sleep_slack(int64_t ticks, int64_t slack)
 {
     int64_t start = timer_ticks();
 
@@ -97,8 +206,8 @@ void timer_sleep(int64_t ticks)
 
     enum intr_level old_level = intr_disable();
     struct thread *cur = thread_current();
-    cur->wake_ticks = start + ticks;
-    list_insert_ordered(get_sleep_list(), &cur->elem, less_wake_ticks, NULL);
+    cur->wake_ticks = apply_slack(start + ticks, slack);
+    wheel_insert(cur);
     thread_block();
     intr_set_level(old_level);
 }
@@ -160,34 +269,270 @@ void timer_ndelay(int64_t ns)
     real_time_delay(ns, 1000 * 1000 * 1000);
 }
 
+/* Called by the idle thread, with interrupts off, just before it
+   halts the CPU.  If tickless idle is enabled and no sleeper,
+   delayed work item, throttled CPU group, or throttled deadline
+   thread is due within the next tick, stops the periodic timer
+   interrupt and arranges for a single one at the tick of the
+   next event instead. */
+void timer_idle_enter(void)
+{
+    int64_t next;
+    unsigned count;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (!timer_tickless || oneshot)
+        return;
+
+    next = ticks + ONESHOT_MAX_TICKS;
+    if (workqueue_next_due() < next)
+        next = workqueue_next_due();
+    if (cpu_group_next_refill() < next)
+        next = cpu_group_next_refill();
+    if (thread_deadline_next_replenish() < next)
+        next = thread_deadline_next_replenish();
+    next = wheel_next_event(next);
+    if (next - ticks <= 1)
+        return;
+
+    /* Keep the phase of the periodic tick by first counting down
+     what is left of the current tick. */
+    count = pit_read_counter(0);
+    oneshot_end = next;
+    oneshot_arm(count + (next - ticks - 1) * TICK_PIT_CYCLES);
+    oneshot = true;
+}
+
+/* Called by the idle thread, with interrupts off, once it is
+   running again after halting.  If it was woken up by some
+   other interrupt before the one-shot timer interrupt, accounts
+   for the ticks that have passed and arms the one-shot
+   interrupt for the next tick boundary, which will restore the
+   periodic tick. */
+void timer_idle_exit(void)
+{
+    unsigned left;
+    bool expired;
+    int64_t cycles, rest;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (!oneshot)
+        return;
+
+    /* A counter that reached zero has wrapped around, so the
+     interrupt that ends the armed one-shot is pending. */
+    left = pit_read_counter(0);
+    expired = left == 0 || left > oneshot_count;
+
+    /* If that was the last of the chain, account for the ticks
+     before it while the idle thread is still running. */
+    if (expired && oneshot_rest == 0)
+    {
+        oneshot_catch_up(oneshot_end - 1 - ticks);
+        return;
+    }
+
+    /* Otherwise, account for the ticks that have passed, and end
+     the chain at the next tick boundary, CYCLES - REST from
+     now. */
+    cycles = expired ? oneshot_rest - oneshot_overshoot(left)
+                     : left + oneshot_rest;
+    if (cycles < 1)
+        cycles = 1;
+    rest = (cycles - 1) / TICK_PIT_CYCLES * TICK_PIT_CYCLES;
+    oneshot_catch_up(oneshot_end - rest / TICK_PIT_CYCLES - 1 - ticks);
+    oneshot_end = ticks + 1;
+    if (expired)
+    {
+        /* The pending interrupt arms what is left. */
+        oneshot_rest -= rest;
+    }
+    else
+        oneshot_arm(cycles - rest);
+}
+
 /* Prints timer statistics. */
 void timer_print_stats(void)
 {
-    printf("Timer: %" PRId64 " ticks\n", timer_ticks());
+    printf("Timer: %" PRId64 " ticks, %lld interrupts\n",
+           timer_ticks(), timer_intr_cnt);
 }
 
-/* Timer interrupt handler. Checks whether there is
-   any thread that can wake up in sleep list. */
+/* Returns the number of timer interrupts taken since the OS
+   booted, which is less than timer_ticks() in tickless mode. */
+long long
+timer_interrupts(void)
+{
+    enum intr_level old_level = intr_disable();
+    long long cnt = timer_intr_cnt;
+    intr_set_level(old_level);
+    return cnt;
+}
+
+/* Timer interrupt handler. Wakes up the threads in the timing
+   wheel whose wake_ticks have come. */
 static void
 timer_interrupt(struct intr_frame *args UNUSED)
 {
+    timer_intr_cnt++;
+    if (oneshot)
+    {
+        /* This interrupt ends a one-shot.  If more of the chain
+         is left, just arm the next one, making up for the
+         cycles since this one ended. */
+        if (oneshot_rest > 0)
+        {
+            oneshot_arm(oneshot_rest - oneshot_overshoot(pit_read_counter(0)));
+            thread_idle_intr();
+            return;
+        }
+
+        /* This interrupt ends the chain.  Account for the ticks
+         before it and go back to the periodic tick, which starts
+         on this tick boundary. */
+        oneshot_catch_up(oneshot_end - 1 - ticks);
+        pit_configure_channel(0, 2, TIMER_FREQ);
+        oneshot = false;
+    }
+
     ticks++;
     thread_tick();
+    wheel_expire();
+    workqueue_expire(ticks);
+    cpu_group_expire(ticks);
+    thread_deadline_expire(ticks);
+}
 
-    struct list *sleep_list = get_sleep_list();
-    while (!list_empty(sleep_list))
+/* Arms a one-shot for up to CYCLES PIT cycles, leaving the rest
+   of them to the ones chained after it. */
+static void
+oneshot_arm(int64_t cycles)
+{
+    if (cycles < 1)
+        cycles = 1;
+    oneshot_count = cycles < ONESHOT_MAX_COUNT ? cycles : ONESHOT_MAX_COUNT;
+    oneshot_rest = cycles - oneshot_count;
+    pit_configure_oneshot(0, oneshot_count);
+}
+
+/* Returns the PIT cycles since the armed one-shot ended, given
+   the counter value LEFT, which keeps counting down past zero
+   and wraps around. */
+static unsigned
+oneshot_overshoot(unsigned left)
+{
+    return left == 0 ? 0 : 65536 - left;
+}
+
+/* Accounts for CNT ticks that passed in one-shot mode without a
+   timer interrupt of their own.  The idle thread ran during all
+   of them. */
+static void
+oneshot_catch_up(int64_t cnt)
+{
+    while (cnt-- > 0)
     {
-        struct list_elem *e = list_front(sleep_list);
-        struct thread *t = list_entry(e, struct thread, elem);
+        ticks++;
+        thread_idle_tick();
+        wheel_expire();
+        workqueue_expire(ticks);
+        cpu_group_expire(ticks);
+        thread_deadline_expire(ticks);
+    }
+}
 
-        if (t->wake_ticks <= ticks)
-        {
-            list_pop_front(sleep_list);
-            thread_unblock(t);
-        }
-        else
-            break;
+/* Wakes up the threads in the timing wheel whose wake_ticks have
+   come. */
+static void
+wheel_expire(void)
+{
+    while (wheel_ticks <= ticks)
+    {
+        struct list *slot = &wheel0[wheel_ticks & (WHEEL0_SLOTS - 1)];
+
+        if ((wheel_ticks & (WHEEL0_SLOTS - 1)) == 0)
+            wheel_cascade(1);
+        while (!list_empty(slot))
+            thread_unblock(list_entry(list_pop_front(slot), struct thread, elem));
+        wheel_ticks++;
+    }
+}
+
+/* Puts T, which is about to block, into the timing wheel slot for
+   its wake_ticks. */
+static void
+wheel_insert(struct thread *t)
+{
+    int64_t wake_ticks = t->wake_ticks, delta = wake_ticks - wheel_ticks;
+    int level;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (delta < WHEEL0_SLOTS)
+    {
+        /* Deadlines that have already passed are expired on the
+         next tick. */
+        if (delta < 0)
+            wake_ticks = wheel_ticks;
+        list_push_back(&wheel0[wake_ticks & (WHEEL0_SLOTS - 1)], &t->elem);
+        return;
     }
+
+    if (delta > WHEEL_MAX_DELTA)
+        wake_ticks = wheel_ticks + WHEEL_MAX_DELTA;
+    for (level = 1; delta >= (int64_t)1 << WHEEL_BITS(level + 1) && level < WHEEL_LEVELS - 1; level++)
+        continue;
+    list_push_back(&wheeln[level - 1][(wake_ticks >> WHEEL_BITS(level)) & (WHEELN_SLOTS - 1)],
+                   &t->elem);
+}
+
+/* Returns the first tick before LIMIT at which the timing wheel
+   has work to do, that is, a level 0 slot to expire or a level 0
+   wrap-around that cascades higher levels, or LIMIT if there is
+   none. */
+static int64_t
+wheel_next_event(int64_t limit)
+{
+    int64_t t;
+
+    for (t = wheel_ticks; t < limit; t++)
+        if ((t & (WHEEL0_SLOTS - 1)) == 0 || !list_empty(&wheel0[t & (WHEEL0_SLOTS - 1)]))
+            return t;
+    return limit;
+}
+
+/* Re-inserts the threads in the slot of LEVEL that covers
+   wheel_ticks into lower levels, after first doing the same for
+   the level above if LEVEL has wrapped around too. */
+static void
+wheel_cascade(int level)
+{
+    int idx = (wheel_ticks >> WHEEL_BITS(level)) & (WHEELN_SLOTS - 1);
+    struct list *slot = &wheeln[level - 1][idx];
+
+    if (idx == 0 && level < WHEEL_LEVELS - 1)
+        wheel_cascade(level + 1);
+    while (!list_empty(slot))
+        wheel_insert(list_entry(list_pop_front(slot), struct thread, elem));
+}
+
+/* Returns the tick in [WAKE_TICKS, WAKE_TICKS + SLACK] with the
+   most trailing zero bits. */
+static int64_t
+apply_slack(int64_t wake_ticks, int64_t slack)
+{
+    int64_t limit = wake_ticks + slack, mask;
+
+    if (slack <= 0 || wake_ticks < 0)
+        return wake_ticks;
+
+    /* Clear every bit of LIMIT below the highest bit in which it
+     differs from WAKE_TICKS. */
+    for (mask = wake_ticks ^ limit; mask & (mask - 1); mask &= mask - 1)
+        continue;
+    return limit & ~(mask - 1);
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
@@ -261,13 +606,3 @@ real_time_delay(int64_t num, int32_t denom)
     busy_wait(loops_per_tick * num / 1000 * TIMER_FREQ / (denom / 1000));
 }
 
-/* Compares wake_ticks of two list elements A and B.
-   Returns true if A is less than B, or false if A is
-   greater than or equal to B. */
-static bool
-less_wake_ticks(const struct list_elem *a, const struct list_elem *b, void *aux UNUSED)
-{
-    const struct thread *a_t = list_entry(a, struct thread, elem);
-    const struct thread *b_t = list_entry(b, struct thread, elem);
-    return a_t->wake_ticks < b_t->wake_ticks;
-}
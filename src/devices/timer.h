@@ -2,19 +2,28 @@
 #define DEVICES_TIMER_H
 
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /* Number of timer interrupts per second. */
 #define TIMER_FREQ 100
 
+/* If false (default), take a timer interrupt every tick.
+   If true, stop the periodic tick while the CPU is idle.
+   Controlled by kernel command-line option "-tickless". */
+extern bool timer_tickless;
+
 void timer_init(void);
 void timer_calibrate(void);
 
 int64_t timer_ticks(void);
 int64_t timer_elapsed(int64_t);
+int64_t timer_ns(void);
+long long timer_interrupts(void);
 
 /* Sleep and yield the CPU to other threads. */
 void timer_sleep(int64_t ticks);
+void timer_sleep_slack(int64_t ticks, int64_t slack);
 void timer_msleep(int64_t milliseconds);
 void timer_usleep(int64_t microseconds);
 void timer_nsleep(int64_t nanoseconds);
@@ -24,6 +33,10 @@ void timer_mdelay(int64_t milliseconds);
 void timer_udelay(int64_t microseconds);
 void timer_ndelay(int64_t nanoseconds);
 
+/* Tickless idle. */
+void timer_idle_enter(void);
+void timer_idle_exit(void);
+
 void timer_print_stats(void);
 
 #endif /* devices/timer.h */
@@ -4,7 +4,7 @@
 #include <list.h>
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
-#include "threads/malloc.h"
+#include "threads/slab.h"
 
 /* A directory. */
 struct dir
@@ -21,6 +21,15 @@ struct dir_entry
     bool in_use;                 /* In use or free? */
 };
 
+/* Cache of open directories. */
+static struct slab_cache dir_cache;
+
+/* Initializes the directory module. */
+void dir_init(void)
+{
+    slab_cache_init(&dir_cache, "dir", sizeof(struct dir), 0, NULL);
+}
+
 /* Creates a directory with space for ENTRY_CNT entries in the
    given SECTOR.  Returns true if successful, false on failure. */
 bool dir_create(block_sector_t sector, size_t entry_cnt)
@@ -33,7 +42,7 @@ bool dir_create(block_sector_t sector, size_t entry_cnt)
 struct dir *
 dir_open(struct inode *inode)
 {
-    struct dir *dir = calloc(1, sizeof *dir);
+    struct dir *dir = slab_alloc(&dir_cache);
     if (inode != NULL && dir != NULL)
     {
         dir->inode = inode;
@@ -43,7 +52,7 @@ dir_open(struct inode *inode)
     else
     {
         inode_close(inode);
-        free(dir);
+        slab_free(&dir_cache, dir);
         return NULL;
     }
 }
@@ -70,7 +79,7 @@ void dir_close(struct dir *dir)
     if (dir != NULL)
     {
         inode_close(dir->inode);
-        free(dir);
+        slab_free(&dir_cache, dir);
     }
 }
 
@@ -1,7 +1,7 @@
 #include "filesys/file.h"
 #include <debug.h>
 #include "filesys/inode.h"
-#include "threads/malloc.h"
+#include "threads/slab.h"
 
 /* An open file. */
 struct file
@@ -11,13 +11,22 @@ struct file
     bool deny_write;     /* Has file_deny_write() been called? */
 };
 
+/* Cache of open files. */
+static struct slab_cache file_cache;
+
+/* Initializes the file module. */
+void file_init(void)
+{
+    slab_cache_init(&file_cache, "file", sizeof(struct file), 0, NULL);
+}
+
 /* Opens a file for the given INODE, of which it takes ownership,
    and returns the new file.  Returns a null pointer if an
    allocation fails or if INODE is null. */
 struct file *
 file_open(struct inode *inode)
 {
-    struct file *file = calloc(1, sizeof *file);
+    struct file *file = slab_alloc(&file_cache);
     if (inode != NULL && file != NULL)
     {
         file->inode = inode;
@@ -28,7 +37,7 @@ file_open(struct inode *inode)
     else
     {
         inode_close(inode);
-        free(file);
+        slab_free(&file_cache, file);
         return NULL;
     }
 }
@@ -48,7 +57,7 @@ void file_close(struct file *file)
     {
         file_allow_write(file);
         inode_close(file->inode);
-        free(file);
+        slab_free(&file_cache, file);
     }
 }
 
@@ -3,6 +3,7 @@
 #include <limits.h>
 #include <round.h>
 #include <stdio.h>
+#include <string.h>
 #include "threads/malloc.h"
 #ifdef FILESYS
 #include "filesys/file.h"
@@ -21,13 +22,30 @@ typedef unsigned long elem_type;
 /* Number of bits in an element. */
 #define ELEM_BITS (sizeof(elem_type) * CHAR_BIT)
 
+/* Bitmaps with at least this many bits keep a summary level. */
+#define SUMMARY_MIN_BITS (ELEM_BITS * ELEM_BITS)
+
 /* From the outside, a bitmap is an array of bits.  From the
    inside, it's an array of elem_type (defined above) that
-   simulates an array of bits. */
+   simulates an array of bits.
+
+   Operations on many bits work an element at a time, and
+   searches use the processor's bit-scan instruction to find
+   the first interesting bit in an element.
+
+   Large bitmaps also keep a summary: one bit per element of
+   BITS, which is set if that element may contain a false bit.
+   Searching for false bits, which is how a bitmap is normally
+   used to allocate, skips over the elements whose summary bit
+   is clear, so a mostly-true bitmap is searched ELEM_BITS
+   elements at a time.  A summary bit is only ever clear when
+   its element has no false bit; see update_summary() for how
+   that is maintained without locking. */
 struct bitmap
 {
-    size_t bit_cnt;  /* Number of bits. */
-    elem_type *bits; /* Elements that represent bits. */
+    size_t bit_cnt;     /* Number of bits. */
+    elem_type *bits;    /* Elements that represent bits. */
+    elem_type *summary; /* Summary of BITS, or null if none. */
 };
 
 /* Returns the index of the element that contains the bit
@@ -69,6 +87,51 @@ last_mask(const struct bitmap *b)
     return last_bits ? ((elem_type)1 << last_bits) - 1 : (elem_type)-1;
 }
 
+/* Returns the number of bytes required for the summary of a
+   bitmap with BIT_CNT bits, which is 0 if it has none. */
+static inline size_t
+summary_byte_cnt(size_t bit_cnt)
+{
+    return bit_cnt >= SUMMARY_MIN_BITS ? byte_cnt(elem_cnt(bit_cnt)) : 0;
+}
+
+/* Returns the index of the least significant bit set in W,
+   which must be nonzero. */
+static inline size_t
+first_set(elem_type w)
+{
+    elem_type idx;
+    asm("bsfl %1, %0"
+        : "=r"(idx)
+        : "rm"(w)
+        : "cc");
+    return idx;
+}
+
+/* Returns the number of bits set in W. */
+static inline size_t
+pop_count(elem_type w)
+{
+    w = w - ((w >> 1) & 0x55555555);
+    w = (w & 0x33333333) + ((w >> 2) & 0x33333333);
+    w = (w + (w >> 4)) & 0x0f0f0f0f;
+    return (w * 0x01010101) >> 24;
+}
+
+/* Returns a mask of the bits in the element that holds bit
+   START that lie between START and START + CNT, exclusive. */
+static inline elem_type
+range_mask(size_t start, size_t cnt)
+{
+    size_t ofs = start % ELEM_BITS;
+    elem_type high = cnt < ELEM_BITS - ofs ? ((elem_type)1 << (ofs + cnt)) - 1 : (elem_type)-1;
+    return high & ~(((elem_type)1 << ofs) - 1);
+}
+
+static void init_summary(struct bitmap *);
+static void update_summary(struct bitmap *, size_t elem);
+static size_t find_next(const struct bitmap *, size_t start, bool);
+
 /* Creation and destruction. */
 
 /* Creates and returns a pointer to a newly allocated bitmap with room for
@@ -83,11 +146,17 @@ bitmap_create(size_t bit_cnt)
     {
         b->bit_cnt = bit_cnt;
         b->bits = malloc(byte_cnt(bit_cnt));
-        if (b->bits != NULL || bit_cnt == 0)
+        b->summary = NULL;
+        if (summary_byte_cnt(bit_cnt) > 0)
+            b->summary = malloc(summary_byte_cnt(bit_cnt));
+        if ((b->bits != NULL || bit_cnt == 0)
+            && (b->summary != NULL || summary_byte_cnt(bit_cnt) == 0))
         {
+            init_summary(b);
             bitmap_set_all(b, false);
             return b;
         }
+        free(b->bits);
         free(b);
     }
     return NULL;
@@ -105,6 +174,8 @@ bitmap_create_in_buf(size_t bit_cnt, void *block, size_t block_size UNUSED)
 
     b->bit_cnt = bit_cnt;
     b->bits = (elem_type *)(b + 1);
+    b->summary = summary_byte_cnt(bit_cnt) > 0 ? b->bits + elem_cnt(bit_cnt) : NULL;
+    init_summary(b);
     bitmap_set_all(b, false);
     return b;
 }
@@ -114,7 +185,7 @@ bitmap_create_in_buf(size_t bit_cnt, void *block, size_t block_size UNUSED)
 size_t
 bitmap_buf_size(size_t bit_cnt)
 {
-    return sizeof(struct bitmap) + byte_cnt(bit_cnt);
+    return sizeof(struct bitmap) + byte_cnt(bit_cnt) + summary_byte_cnt(bit_cnt);
 }
 
 /* Destroys bitmap B, freeing its storage.
@@ -123,6 +194,7 @@ void bitmap_destroy(struct bitmap *b)
 {
     if (b != NULL)
     {
+        free(b->summary);
         free(b->bits);
         free(b);
     }
@@ -163,6 +235,7 @@ void bitmap_mark(struct bitmap *b, size_t bit_idx)
         : "=m"(b->bits[idx])
         : "r"(mask)
         : "cc");
+    update_summary(b, idx);
 }
 
 /* Atomically sets the bit numbered BIT_IDX in B to false. */
@@ -178,6 +251,7 @@ void bitmap_reset(struct bitmap *b, size_t bit_idx)
         : "=m"(b->bits[idx])
         : "r"(~mask)
         : "cc");
+    update_summary(b, idx);
 }
 
 /* Atomically toggles the bit numbered IDX in B;
@@ -195,6 +269,7 @@ void bitmap_flip(struct bitmap *b, size_t bit_idx)
         : "=m"(b->bits[idx])
         : "r"(mask)
         : "cc");
+    update_summary(b, idx);
 }
 
 /* Returns the value of the bit numbered IDX in B. */
@@ -218,14 +293,35 @@ void bitmap_set_all(struct bitmap *b, bool value)
 /* Sets the CNT bits starting at START in B to VALUE. */
 void bitmap_set_multiple(struct bitmap *b, size_t start, size_t cnt, bool value)
 {
-    size_t i;
-
     ASSERT(b != NULL);
     ASSERT(start <= b->bit_cnt);
     ASSERT(start + cnt <= b->bit_cnt);
 
-    for (i = 0; i < cnt; i++)
-        bitmap_set(b, start + i, value);
+    while (cnt > 0)
+    {
+        size_t idx = elem_idx(start);
+        size_t n = ELEM_BITS - start % ELEM_BITS;
+        elem_type mask = range_mask(start, cnt);
+
+        if (n > cnt)
+            n = cnt;
+        if (mask == (elem_type)-1)
+            b->bits[idx] = value ? mask : 0;
+        else if (value)
+            asm("orl %1, %0"
+                : "=m"(b->bits[idx])
+                : "r"(mask)
+                : "cc");
+        else
+            asm("andl %1, %0"
+                : "=m"(b->bits[idx])
+                : "r"(~mask)
+                : "cc");
+        update_summary(b, idx);
+
+        start += n;
+        cnt -= n;
+    }
 }
 
 /* Returns the number of bits in B between START and START + CNT,
@@ -233,32 +329,46 @@ void bitmap_set_multiple(struct bitmap *b, size_t start, size_t cnt, bool value)
 size_t
 bitmap_count(const struct bitmap *b, size_t start, size_t cnt, bool value)
 {
-    size_t i, value_cnt;
+    size_t true_cnt = 0;
+    size_t total = cnt;
 
     ASSERT(b != NULL);
     ASSERT(start <= b->bit_cnt);
     ASSERT(start + cnt <= b->bit_cnt);
 
-    value_cnt = 0;
-    for (i = 0; i < cnt; i++)
-        if (bitmap_test(b, start + i) == value)
-            value_cnt++;
-    return value_cnt;
+    while (cnt > 0)
+    {
+        size_t n = ELEM_BITS - start % ELEM_BITS;
+
+        if (n > cnt)
+            n = cnt;
+        true_cnt += pop_count(b->bits[elem_idx(start)] & range_mask(start, n));
+        start += n;
+        cnt -= n;
+    }
+    return value ? true_cnt : total - true_cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
    exclusive, are set to VALUE, and false otherwise. */
 bool bitmap_contains(const struct bitmap *b, size_t start, size_t cnt, bool value)
 {
-    size_t i;
-
     ASSERT(b != NULL);
     ASSERT(start <= b->bit_cnt);
     ASSERT(start + cnt <= b->bit_cnt);
 
-    for (i = 0; i < cnt; i++)
-        if (bitmap_test(b, start + i) == value)
+    while (cnt > 0)
+    {
+        size_t n = ELEM_BITS - start % ELEM_BITS;
+        elem_type w = b->bits[elem_idx(start)];
+
+        if (n > cnt)
+            n = cnt;
+        if ((value ? w : ~w) & range_mask(start, n))
             return true;
+        start += n;
+        cnt -= n;
+    }
     return false;
 }
 
@@ -295,13 +405,24 @@ bitmap_scan(const struct bitmap *b, size_t start, size_t cnt, bool value)
     ASSERT(b != NULL);
     ASSERT(start <= b->bit_cnt);
 
-    if (cnt <= b->bit_cnt)
+    if (cnt == 0)
+        return start;
+
+    /* Find each run of bits set to VALUE in turn, until one is
+     long enough. */
+    while (cnt <= b->bit_cnt - start)
     {
-        size_t last = b->bit_cnt - cnt;
-        size_t i;
-        for (i = start; i <= last; i++)
-            if (!bitmap_contains(b, i, cnt, !value))
-                return i;
+        size_t run_start = find_next(b, start, value);
+        size_t run_end;
+
+        if (run_start == BITMAP_ERROR || cnt > b->bit_cnt - run_start)
+            break;
+        run_end = find_next(b, run_start, !value);
+        if (run_end == BITMAP_ERROR)
+            run_end = b->bit_cnt;
+        if (run_end - run_start >= cnt)
+            return run_start;
+        start = run_end;
     }
     return BITMAP_ERROR;
 }
@@ -322,6 +443,96 @@ bitmap_scan_and_flip(struct bitmap *b, size_t start, size_t cnt, bool value)
     return idx;
 }
 
+/* Returns the index of the first bit in B at or after START
+   that is set to VALUE, or BITMAP_ERROR if there is none. */
+static size_t
+find_next(const struct bitmap *b, size_t start, bool value)
+{
+    size_t cnt = elem_cnt(b->bit_cnt);
+    size_t idx = elem_idx(start);
+    elem_type w;
+
+    if (start >= b->bit_cnt)
+        return BITMAP_ERROR;
+
+    /* Check the rest of the first element. */
+    w = (value ? b->bits[idx] : ~b->bits[idx]) & ~(bit_mask(start) - 1);
+    while (w == 0)
+    {
+        if (++idx >= cnt)
+            return BITMAP_ERROR;
+
+        /* Skip elements that the summary says have no false bit. */
+        if (!value && b->summary != NULL)
+        {
+            size_t s_idx = elem_idx(idx);
+            elem_type s = b->summary[s_idx] & ~(bit_mask(idx) - 1);
+
+            while (s == 0)
+            {
+                if (++s_idx >= elem_cnt(cnt))
+                    return BITMAP_ERROR;
+                s = b->summary[s_idx];
+            }
+            idx = s_idx * ELEM_BITS + first_set(s);
+            if (idx >= cnt)
+                return BITMAP_ERROR;
+        }
+        w = value ? b->bits[idx] : ~b->bits[idx];
+    }
+
+    start = idx * ELEM_BITS + first_set(w);
+    return start < b->bit_cnt ? start : BITMAP_ERROR;
+}
+
+/* Clears B's summary, if it has one, including the bits past
+   the last element. */
+static void
+init_summary(struct bitmap *b)
+{
+    if (b->summary != NULL)
+        memset(b->summary, 0, summary_byte_cnt(b->bit_cnt));
+}
+
+/* Brings the summary bit for element IDX of B's bits up to date,
+   after bits in that element have changed.
+
+   The summary bit is cleared only if the element has no false
+   bit, and then the element is checked again, in case another
+   thread or an interrupt handler cleared a bit in it and set the
+   summary bit in between.  This keeps the summary bit set
+   whenever the element has a false bit, without locking. */
+static void
+update_summary(struct bitmap *b, size_t idx)
+{
+    elem_type mask = bit_mask(idx);
+    elem_type pad;
+
+    if (b->summary == NULL)
+        return;
+
+    /* Bits past the end of the bitmap don't count as false. */
+    pad = idx == elem_cnt(b->bit_cnt) - 1 ? ~last_mask(b) : 0;
+    if ((b->bits[idx] | pad) != (elem_type)-1)
+    {
+        asm("orl %1, %0"
+            : "=m"(b->summary[elem_idx(idx)])
+            : "r"(mask)
+            : "cc");
+        return;
+    }
+
+    asm("andl %1, %0"
+        : "=m"(b->summary[elem_idx(idx)])
+        : "r"(~mask)
+        : "cc");
+    if ((*(volatile elem_type *)&b->bits[idx] | pad) != (elem_type)-1)
+        asm("orl %1, %0"
+            : "=m"(b->summary[elem_idx(idx)])
+            : "r"(mask)
+            : "cc");
+}
+
 /* File input and output. */
 
 #ifdef FILESYS
@@ -340,8 +551,12 @@ bool bitmap_read(struct bitmap *b, struct file *file)
     if (b->bit_cnt > 0)
     {
         off_t size = byte_cnt(b->bit_cnt);
+        size_t i;
+
         success = file_read_at(file, b->bits, size, 0) == size;
         b->bits[elem_cnt(b->bit_cnt) - 1] &= last_mask(b);
+        for (i = 0; i < elem_cnt(b->bit_cnt); i++)
+            update_summary(b, i);
     }
     return success;
 }
@@ -72,6 +72,10 @@ print_stacktrace(struct thread *t, void *aux UNUSED)
         status = "BLOCKED";
         break;
 
+    case THREAD_PARKED:
+        status = "PARKED";
+        break;
+
     default:
         break;
     }
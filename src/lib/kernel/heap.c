@@ -0,0 +1,190 @@
+/* Priority queue.
+
+   See heap.h for basic information. */
+
+#include "heap.h"
+#include "../debug.h"
+
+static struct heap_elem *meld(struct heap *, struct heap_elem *,
+                              struct heap_elem *);
+static struct heap_elem *merge_pairs(struct heap *, struct heap_elem *);
+static void cut(struct heap_elem *);
+
+/* Initializes heap H as empty, comparing elements with LESS
+   given auxiliary data AUX. */
+void heap_init(struct heap *h, heap_less_func *less, void *aux)
+{
+    ASSERT(h != NULL);
+    ASSERT(less != NULL);
+
+    h->root = NULL;
+    h->elem_cnt = 0;
+    h->less = less;
+    h->aux = aux;
+}
+
+/* Inserts E into H. */
+void heap_insert(struct heap *h, struct heap_elem *e)
+{
+    ASSERT(h != NULL);
+    ASSERT(e != NULL);
+
+    e->child = e->next = e->prev = NULL;
+    h->root = meld(h, h->root, e);
+    h->elem_cnt++;
+}
+
+/* Removes E, which must be in H, from H. */
+void heap_remove(struct heap *h, struct heap_elem *e)
+{
+    struct heap_elem *children;
+
+    ASSERT(h != NULL);
+    ASSERT(e != NULL);
+    ASSERT(h->elem_cnt > 0);
+
+    if (e == h->root)
+    {
+        heap_pop(h);
+        return;
+    }
+
+    cut(e);
+    children = merge_pairs(h, e->child);
+    e->child = NULL;
+    h->root = meld(h, h->root, children);
+    h->elem_cnt--;
+}
+
+/* Repositions E, which must be in H, after its key has
+   changed. */
+void heap_update(struct heap *h, struct heap_elem *e)
+{
+    heap_remove(h, e);
+    heap_insert(h, e);
+}
+
+/* Removes and returns the greatest element in H, which must not
+   be empty. */
+struct heap_elem *
+heap_pop(struct heap *h)
+{
+    struct heap_elem *top;
+
+    ASSERT(h != NULL);
+    ASSERT(!heap_empty(h));
+
+    top = h->root;
+    h->root = merge_pairs(h, top->child);
+    top->child = NULL;
+    h->elem_cnt--;
+    return top;
+}
+
+/* Returns the greatest element in H, which must not be empty. */
+struct heap_elem *
+heap_top(const struct heap *h)
+{
+    ASSERT(h != NULL);
+    ASSERT(!heap_empty(h));
+
+    return h->root;
+}
+
+/* Returns the number of elements in H. */
+size_t
+heap_size(const struct heap *h)
+{
+    ASSERT(h != NULL);
+    return h->elem_cnt;
+}
+
+/* Returns true if H is empty, false otherwise. */
+bool heap_empty(const struct heap *h)
+{
+    ASSERT(h != NULL);
+    return h->root == NULL;
+}
+
+/* Melds the heaps rooted at A and B, either of which may be
+   null, and returns the root of the result.  A and B must not
+   have siblings. */
+static struct heap_elem *
+meld(struct heap *h, struct heap_elem *a, struct heap_elem *b)
+{
+    if (a == NULL)
+        return b;
+    if (b == NULL)
+        return a;
+
+    /* Make A the greater root and B its first child. */
+    if (h->less(a, b, h->aux))
+    {
+        struct heap_elem *t = a;
+        a = b;
+        b = t;
+    }
+    b->next = a->child;
+    if (a->child != NULL)
+        a->child->prev = b;
+    b->prev = a;
+    a->child = b;
+    return a;
+}
+
+/* Melds the list of siblings starting at FIRST into a single
+   heap and returns its root, using the standard two-pass
+   pairing: meld pairs from left to right, then meld the results
+   from right to left. */
+static struct heap_elem *
+merge_pairs(struct heap *h, struct heap_elem *first)
+{
+    struct heap_elem *pairs = NULL;
+    struct heap_elem *root = NULL;
+
+    /* First pass.  The melded pairs are chained in reverse
+       through their `next' members. */
+    while (first != NULL)
+    {
+        struct heap_elem *a = first, *b = a->next, *m;
+
+        if (b != NULL)
+        {
+            first = b->next;
+            a->next = a->prev = b->next = b->prev = NULL;
+            m = meld(h, a, b);
+        }
+        else
+        {
+            first = NULL;
+            a->prev = NULL;
+            m = a;
+        }
+        m->next = pairs;
+        pairs = m;
+    }
+
+    /* Second pass. */
+    while (pairs != NULL)
+    {
+        struct heap_elem *next = pairs->next;
+        pairs->next = pairs->prev = NULL;
+        root = meld(h, root, pairs);
+        pairs = next;
+    }
+    return root;
+}
+
+/* Detaches E, which must not be a root, from its parent and
+   siblings.  E keeps its children. */
+static void
+cut(struct heap_elem *e)
+{
+    if (e->prev->child == e)
+        e->prev->child = e->next;
+    else
+        e->prev->next = e->next;
+    if (e->next != NULL)
+        e->next->prev = e->prev;
+    e->next = e->prev = NULL;
+}
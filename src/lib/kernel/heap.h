@@ -0,0 +1,70 @@
+#ifndef __LIB_KERNEL_HEAP_H
+#define __LIB_KERNEL_HEAP_H
+
+/* Priority queue.
+
+   This is a pairing heap [Fredman86].  Like the linked list and
+   hash table implementations, it does not use dynamic
+   allocation: each structure that can potentially be in a heap
+   must embed a struct heap_elem member, and the heap_entry macro
+   converts a struct heap_elem back into the structure that
+   contains it.  Refer to lib/kernel/list.h for a detailed
+   explanation of the technique.
+
+   The heap keeps the greatest element, as defined by the
+   heap_less_func passed to heap_init(), on top.  heap_top() is
+   O(1), heap_insert() is O(1), and heap_pop() and heap_remove()
+   are O(lg n) amortized.  Elements that compare equal come out
+   in no particular order, so a caller that wants FIFO order
+   among equals must break ties itself.
+
+   If the key of an element in a heap changes, the element must
+   be repositioned with heap_update(). */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Heap element. */
+struct heap_elem
+{
+    struct heap_elem *child; /* First child. */
+    struct heap_elem *next;  /* Next sibling. */
+    struct heap_elem *prev;  /* Previous sibling, or parent if first child. */
+};
+
+/* Converts pointer to heap element HEAP_ELEM into a pointer to
+   the structure that HEAP_ELEM is embedded inside.  Supply the
+   name of the outer structure STRUCT and the member name MEMBER
+   of the heap element. */
+#define heap_entry(HEAP_ELEM, STRUCT, MEMBER) \
+    ((STRUCT *)((uint8_t *)&(HEAP_ELEM)->child - offsetof(STRUCT, MEMBER.child)))
+
+/* Compares the value of two heap elements A and B, given
+   auxiliary data AUX.  Returns true if A is less than B, or
+   false if A is greater than or equal to B. */
+typedef bool heap_less_func(const struct heap_elem *a,
+                            const struct heap_elem *b,
+                            void *aux);
+
+/* Heap. */
+struct heap
+{
+    struct heap_elem *root; /* Greatest element, or null if empty. */
+    size_t elem_cnt;        /* Number of elements. */
+    heap_less_func *less;   /* Comparison function. */
+    void *aux;              /* Auxiliary data for `less'. */
+};
+
+void heap_init(struct heap *, heap_less_func *, void *aux);
+
+void heap_insert(struct heap *, struct heap_elem *);
+void heap_remove(struct heap *, struct heap_elem *);
+void heap_update(struct heap *, struct heap_elem *);
+struct heap_elem *heap_pop(struct heap *);
+
+struct heap_elem *heap_top(const struct heap *);
+size_t heap_size(const struct heap *);
+bool heap_empty(const struct heap *);
+
+#endif /* lib/kernel/heap.h */
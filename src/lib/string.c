@@ -1,5 +1,23 @@
 #include <string.h>
 #include <debug.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* The memory functions below move data a 32-bit word at a time,
+   using the string instructions for bulk copying and filling,
+   and fall back to bytes only for the unaligned head and tail of
+   a block.  WORD lets them read memory of any type as words. */
+typedef uint32_t word __attribute__((__may_alias__));
+
+/* Blocks shorter than this are handled a byte at a time. */
+#define SHORT_BLOCK 16
+
+/* Returns true if any byte of W is zero. */
+static inline bool
+has_zero_byte(word w)
+{
+    return ((w - 0x01010101) & ~w & 0x80808080) != 0;
+}
 
 /* Copies SIZE bytes from SRC to DST, which must not overlap.
    Returns DST. */
@@ -12,8 +30,37 @@ memcpy(void *dst_, const void *src_, size_t size)
     ASSERT(dst != NULL || size == 0);
     ASSERT(src != NULL || size == 0);
 
-    while (size-- > 0)
-        *dst++ = *src++;
+    /* Whole words at aligned addresses, such as whole pages. */
+    if ((((uintptr_t)dst | (uintptr_t)src | size) & 3) == 0)
+    {
+        size /= 4;
+        asm volatile("rep movsl"
+                     : "+D"(dst), "+S"(src), "+c"(size)
+                     :
+                     : "memory");
+        return dst_;
+    }
+
+    if (size >= SHORT_BLOCK)
+    {
+        /* Copy bytes until DST is aligned, then words. */
+        size_t head = -(uintptr_t)dst & 3;
+        size_t words = (size - head) / 4;
+
+        size -= head + words * 4;
+        asm volatile("rep movsb"
+                     : "+D"(dst), "+S"(src), "+c"(head)
+                     :
+                     : "memory");
+        asm volatile("rep movsl"
+                     : "+D"(dst), "+S"(src), "+c"(words)
+                     :
+                     : "memory");
+    }
+    asm volatile("rep movsb"
+                 : "+D"(dst), "+S"(src), "+c"(size)
+                 :
+                 : "memory");
 
     return dst_;
 }
@@ -29,20 +76,37 @@ memmove(void *dst_, const void *src_, size_t size)
     ASSERT(dst != NULL || size == 0);
     ASSERT(src != NULL || size == 0);
 
-    if (dst < src)
+    /* Copying forward is safe unless DST starts inside SRC. */
+    if (dst <= src || dst >= src + size)
+        return memcpy(dst_, src_, size);
+
+    /* Copy backward: words from the end, then the bytes left
+     over at the start.  The direction flag must be clear again
+     before anything else runs. */
+    if (size >= 4)
     {
-        while (size-- > 0)
-            *dst++ = *src++;
+        unsigned char *d = dst + size - 4;
+        const unsigned char *s = src + size - 4;
+        size_t words = size / 4;
+
+        asm volatile("std; rep movsl; cld"
+                     : "+D"(d), "+S"(s), "+c"(words)
+                     :
+                     : "memory");
     }
-    else
+    if (size % 4 != 0)
     {
-        dst += size;
-        src += size;
-        while (size-- > 0)
-            *--dst = *--src;
+        unsigned char *d = dst + size % 4 - 1;
+        const unsigned char *s = src + size % 4 - 1;
+        size_t bytes = size % 4;
+
+        asm volatile("std; rep movsb; cld"
+                     : "+D"(d), "+S"(s), "+c"(bytes)
+                     :
+                     : "memory");
     }
 
-    return dst;
+    return dst_;
 }
 
 /* Find the first differing byte in the two blocks of SIZE bytes
@@ -57,6 +121,12 @@ int memcmp(const void *a_, const void *b_, size_t size)
     ASSERT(a != NULL || size == 0);
     ASSERT(b != NULL || size == 0);
 
+    /* Skip over equal words, then find the differing byte. */
+    for (; size >= 4 && *(const word *)a == *(const word *)b; size -= 4)
+    {
+        a += 4;
+        b += 4;
+    }
     for (; size-- > 0; a++, b++)
         if (*a != *b)
             return *a > *b ? +1 : -1;
@@ -280,8 +350,37 @@ memset(void *dst_, int value, size_t size)
 
     ASSERT(dst != NULL || size == 0);
 
-    while (size-- > 0)
-        *dst++ = value;
+    /* Whole words at aligned addresses, such as whole pages. */
+    if ((((uintptr_t)dst | size) & 3) == 0)
+    {
+        size /= 4;
+        asm volatile("rep stosl"
+                     : "+D"(dst), "+c"(size)
+                     : "a"((value & 0xff) * 0x01010101)
+                     : "memory");
+        return dst_;
+    }
+
+    if (size >= SHORT_BLOCK)
+    {
+        /* Fill bytes until DST is aligned, then words. */
+        size_t head = -(uintptr_t)dst & 3;
+        size_t words = (size - head) / 4;
+
+        size -= head + words * 4;
+        asm volatile("rep stosb"
+                     : "+D"(dst), "+c"(head)
+                     : "a"(value)
+                     : "memory");
+        asm volatile("rep stosl"
+                     : "+D"(dst), "+c"(words)
+                     : "a"((value & 0xff) * 0x01010101)
+                     : "memory");
+    }
+    asm volatile("rep stosb"
+                 : "+D"(dst), "+c"(size)
+                 : "a"(value)
+                 : "memory");
 
     return dst_;
 }
@@ -294,8 +393,16 @@ strlen(const char *string)
 
     ASSERT(string != NULL);
 
-    for (p = string; *p != '\0'; p++)
-        continue;
+    /* Check bytes until P is aligned, then whole words.  An
+     aligned word never crosses a page boundary, so reading past
+     the terminator is safe. */
+    for (p = string; ((uintptr_t)p & 3) != 0; p++)
+        if (*p == '\0')
+            return p - string;
+    while (!has_zero_byte(*(const word *)p))
+        p += 4;
+    while (*p != '\0')
+        p++;
     return p - string;
 }
 
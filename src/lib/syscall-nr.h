@@ -28,7 +28,14 @@ enum
     SYS_MKDIR,   /* Create a directory. */
     SYS_READDIR, /* Reads a directory entry. */
     SYS_ISDIR,   /* Tests if a fd represents a directory. */
-    SYS_INUMBER  /* Returns the inode number for a fd. */
+    SYS_INUMBER, /* Returns the inode number for a fd. */
+
+    /* Deadline scheduling. */
+    SYS_SCHED_DEADLINE,   /* Enter or leave the deadline class. */
+    SYS_SCHED_WAIT_PERIOD, /* End the current job and wait for the next period. */
+
+    /* CPU bandwidth control. */
+    SYS_CPU_LIMIT /* Limit the CPU time of this process and its children. */
 };
 
 #endif /* lib/syscall-nr.h */
@@ -160,3 +160,18 @@ int inumber(int fd)
 {
     return syscall1(SYS_INUMBER, fd);
 }
+
+bool sched_deadline(int runtime, int period)
+{
+    return syscall2(SYS_SCHED_DEADLINE, runtime, period);
+}
+
+int sched_wait_period(void)
+{
+    return syscall0(SYS_SCHED_WAIT_PERIOD);
+}
+
+bool cpu_limit(int quota, int period)
+{
+    return syscall2(SYS_CPU_LIMIT, quota, period);
+}
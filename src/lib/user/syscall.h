@@ -45,4 +45,11 @@ bool readdir(int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir(int fd);
 int inumber(int fd);
 
+/* Deadline scheduling. */
+bool sched_deadline(int runtime, int period);
+int sched_wait_period(void);
+
+/* CPU bandwidth control. */
+bool cpu_limit(int quota, int period);
+
 #endif /* lib/user/syscall.h */
@@ -0,0 +1,91 @@
+/* Creates THREAD_CNT threads that go to sleep at the same time
+   for slightly different durations, allowing SLACK ticks of
+   slack.  Verifies that each thread wakes up within its window
+   and that the wakeups were batched into a few ticks instead of
+   one tick per thread. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 16
+#define SLACK 16
+
+/* Information about an individual thread in the test. */
+struct sleep_thread 
+  {
+    int duration;               /* Number of ticks to sleep. */
+    int64_t start;              /* Time the thread went to sleep. */
+    int64_t woke;               /* Time the thread woke up. */
+    struct semaphore *done;     /* Upped when the thread finishes. */
+  };
+
+static void sleeper (void *);
+
+void
+test_alarm_slack (void) 
+{
+  struct sleep_thread threads[THREAD_CNT];
+  struct semaphore done;
+  int wake_tick_cnt;
+  int i, j;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  msg ("Creating %d threads to sleep 100 to %d ticks with %d ticks "
+       "of slack.", THREAD_CNT, 100 + THREAD_CNT - 1, SLACK);
+
+  sema_init (&done, 0);
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      struct sleep_thread *t = threads + i;
+      char name[16];
+
+      t->duration = 100 + i;
+      t->done = &done;
+      snprintf (name, sizeof name, "thread %d", i);
+      thread_create (name, PRI_DEFAULT + 1, sleeper, t);
+    }
+
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down (&done);
+
+  wake_tick_cnt = 0;
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      struct sleep_thread *t = threads + i;
+
+      if (t->woke < t->start + t->duration)
+        fail ("thread %d woke up early", i);
+      if (t->woke > t->start + t->duration + SLACK)
+        fail ("thread %d woke up after its slack ran out", i);
+
+      for (j = 0; j < i; j++)
+        if (threads[j].woke == t->woke)
+          break;
+      if (j == i)
+        wake_tick_cnt++;
+    }
+  msg ("All threads woke up within their slack.");
+
+  if (wake_tick_cnt > THREAD_CNT / 4)
+    fail ("%d threads woke up on %d different ticks",
+          THREAD_CNT, wake_tick_cnt);
+  msg ("Wakeups were batched.");
+}
+
+/* Sleeper thread. */
+static void
+sleeper (void *t_) 
+{
+  struct sleep_thread *t = t_;
+
+  t->start = timer_ticks ();
+  timer_sleep_slack (t->duration, SLACK);
+  t->woke = timer_ticks ();
+  sema_up (t->done);
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(alarm-slack) begin
+(alarm-slack) Creating 16 threads to sleep 100 to 115 ticks with 16 ticks of slack.
+(alarm-slack) All threads woke up within their slack.
+(alarm-slack) Wakeups were batched.
+(alarm-slack) end
+EOF
+pass;
@@ -0,0 +1,107 @@
+/* Creates THREAD_CNT threads, each of which sleeps a fixed
+   duration, ITERATIONS times.  The durations are spread so that
+   thousands of threads are asleep at once, many of them further
+   away than the timer's first wheel level reaches.  Verifies that
+   every thread wakes up the expected number of times, never
+   early, and never more than a second late. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 2000
+#define ITERATIONS 2
+#define MAX_DURATION 700
+
+/* Information about an individual thread in the test. */
+struct sleep_thread 
+  {
+    int duration;               /* Number of ticks to sleep. */
+    int iterations;             /* Iterations counted so far. */
+    int early;                  /* Number of early wakeups. */
+    int late;                   /* Number of late wakeups. */
+    struct semaphore *done;     /* Upped when the thread finishes. */
+  };
+
+static void sleeper (void *);
+
+void
+test_alarm_thousands (void) 
+{
+  struct sleep_thread *threads;
+  struct semaphore done;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  msg ("Creating %d threads to sleep %d times each.",
+       THREAD_CNT, ITERATIONS);
+  msg ("Sleep durations range from 1 to %d ticks.", MAX_DURATION);
+
+  threads = malloc (sizeof *threads * THREAD_CNT);
+  if (threads == NULL)
+    PANIC ("couldn't allocate memory for test");
+  sema_init (&done, 0);
+
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      struct sleep_thread *t = threads + i;
+      char name[16];
+
+      t->duration = i * 37 % MAX_DURATION + 1;
+      t->iterations = 0;
+      t->early = t->late = 0;
+      t->done = &done;
+
+      snprintf (name, sizeof name, "thread %d", i);
+      if (thread_create (name, PRI_DEFAULT, sleeper, t) == TID_ERROR)
+        fail ("couldn't create thread %d", i);
+    }
+
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down (&done);
+
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      struct sleep_thread *t = threads + i;
+
+      if (t->iterations != ITERATIONS)
+        fail ("thread %d woke up %d times instead of %d",
+              i, t->iterations, ITERATIONS);
+      if (t->early != 0)
+        fail ("thread %d woke up early %d times", i, t->early);
+      if (t->late != 0)
+        fail ("thread %d woke up late %d times", i, t->late);
+    }
+  msg ("All %d threads woke up on time.", THREAD_CNT);
+
+  free (threads);
+}
+
+/* Sleeper thread. */
+static void
+sleeper (void *t_) 
+{
+  struct sleep_thread *t = t_;
+  int i;
+
+  for (i = 0; i < ITERATIONS; i++) 
+    {
+      int64_t wake_up = timer_ticks () + t->duration;
+      int64_t now;
+
+      timer_sleep (t->duration);
+      now = timer_ticks ();
+      if (now < wake_up)
+        t->early++;
+      else if (now > wake_up + TIMER_FREQ)
+        t->late++;
+      t->iterations++;
+    }
+  sema_up (t->done);
+}
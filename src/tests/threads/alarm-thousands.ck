@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(alarm-thousands) begin
+(alarm-thousands) Creating 2000 threads to sleep 2 times each.
+(alarm-thousands) Sleep durations range from 1 to 700 ticks.
+(alarm-thousands) All 2000 threads woke up on time.
+(alarm-thousands) end
+EOF
+pass;
@@ -0,0 +1,58 @@
+/* Runs with the "-tickless" kernel option, so that the timer
+   tick stops while the CPU is idle, and checks that sleeping
+   still works: every sleep of the main thread, with nothing
+   else to run, lasts exactly as many ticks as requested.
+
+   Then checks how many timer interrupts a long idle stretch
+   takes.  The 8254 counts at most 65535 cycles, about 55 ms, in
+   one go, so that is the floor: about 18 interrupts per idle
+   second instead of TIMER_FREQ, plus a few at the edges of the
+   stretch. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "devices/pit.h"
+#include "devices/timer.h"
+
+/* Ticks in the idle stretch. */
+#define IDLE_TICKS 250
+
+void
+test_alarm_tickless (void) 
+{
+  static const int durations[] = {1, 2, 3, 7, 50, 255, 256, 300};
+  size_t i;
+  int64_t start, elapsed;
+  long long intrs, max_intrs;
+
+  ASSERT (timer_tickless);
+
+  for (i = 0; i < sizeof durations / sizeof *durations; i++) 
+    {
+      int64_t start = timer_ticks ();
+      int64_t elapsed;
+
+      timer_sleep (durations[i]);
+      elapsed = timer_elapsed (start);
+      if (elapsed < durations[i])
+        fail ("sleep of %d ticks woke up early after %lld ticks",
+              durations[i], elapsed);
+      if (elapsed > durations[i] + 1)
+        fail ("sleep of %d ticks woke up late after %lld ticks",
+              durations[i], elapsed);
+      msg ("Slept %d ticks.", durations[i]);
+    }
+
+  start = timer_ticks ();
+  intrs = timer_interrupts ();
+  timer_sleep (IDLE_TICKS);
+  elapsed = timer_elapsed (start);
+  intrs = timer_interrupts () - intrs;
+  max_intrs = elapsed * (PIT_HZ / TIMER_FREQ) / 65535 + 4;
+  if (intrs > max_intrs)
+    fail ("%lld timer interrupts in %lld idle ticks, expected at most %lld",
+          intrs, elapsed, max_intrs);
+  msg ("Idle CPU took at most one timer interrupt per 65535 PIT cycles.");
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(alarm-tickless) begin
+(alarm-tickless) Slept 1 ticks.
+(alarm-tickless) Slept 2 ticks.
+(alarm-tickless) Slept 3 ticks.
+(alarm-tickless) Slept 7 ticks.
+(alarm-tickless) Slept 50 ticks.
+(alarm-tickless) Slept 255 ticks.
+(alarm-tickless) Slept 256 ticks.
+(alarm-tickless) Slept 300 ticks.
+(alarm-tickless) Idle CPU took at most one timer interrupt per 65535 PIT cycles.
+(alarm-tickless) end
+EOF
+pass;
@@ -0,0 +1,70 @@
+/* Measures the bitmap operations that allocators rely on, on a
+   bitmap of BIT_CNT bits.
+
+   Reports the cost of setting and counting the whole map, and of
+   scanning a map in which every bit is set except a few near the
+   end, for a single false bit and for a run of RUN_CNT of them:
+   the usual situation for an allocator whose memory is nearly
+   used up.  Run the same test against an older kernel to
+   compare. */
+
+#include <bitmap.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "devices/timer.h"
+
+#define BIT_CNT (1024 * 1024)
+#define RUN_CNT 16
+#define ITER_CNT 16
+
+void
+test_bench_bitmap (void) 
+{
+  struct bitmap *b = bitmap_create (BIT_CNT);
+  int64_t start_ns, set_ns, count_ns, scan_ns, run_ns;
+  size_t idx = 0;
+  int i;
+
+  if (b == NULL)
+    fail ("bitmap_create() failed");
+
+  start_ns = timer_ns ();
+  for (i = 0; i < ITER_CNT; i++)
+    bitmap_set_multiple (b, 0, BIT_CNT, i % 2 == 0);
+  set_ns = (timer_ns () - start_ns) / ITER_CNT;
+
+  start_ns = timer_ns ();
+  for (i = 0; i < ITER_CNT; i++)
+    if (bitmap_count (b, 0, BIT_CNT, false) != BIT_CNT)
+      fail ("bitmap_count() returned a wrong count");
+  count_ns = (timer_ns () - start_ns) / ITER_CNT;
+
+  /* Every bit set except one, near the end. */
+  bitmap_set_all (b, true);
+  bitmap_reset (b, BIT_CNT - 100);
+  start_ns = timer_ns ();
+  for (i = 0; i < ITER_CNT; i++)
+    idx = bitmap_scan (b, 0, 1, false);
+  scan_ns = (timer_ns () - start_ns) / ITER_CNT;
+  if (idx != BIT_CNT - 100)
+    fail ("bitmap_scan() found bit %zu", idx);
+
+  /* Every bit set except single bits every so often, which are
+     too short, and one long enough run near the end. */
+  for (i = 0; i < BIT_CNT - 1000; i += 1000)
+    bitmap_reset (b, i);
+  bitmap_set_multiple (b, BIT_CNT - 50, RUN_CNT, false);
+  start_ns = timer_ns ();
+  for (i = 0; i < ITER_CNT; i++)
+    idx = bitmap_scan (b, 0, RUN_CNT, false);
+  run_ns = (timer_ns () - start_ns) / ITER_CNT;
+  if (idx != BIT_CNT - 50)
+    fail ("bitmap_scan() found run at %zu", idx);
+
+  msg ("bitmap of %d bits.", BIT_CNT);
+  msg ("set_multiple latency: %lld ns.", set_ns);
+  msg ("count latency: %lld ns.", count_ns);
+  msg ("scan for 1 bit latency: %lld ns.", scan_ns);
+  msg ("scan for %d bits latency: %lld ns.", RUN_CNT, run_ns);
+  bitmap_destroy (b);
+}
@@ -0,0 +1,9 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::threads::bench;
+check_bench (qr/set_multiple latency: \d+ ns\./,
+	     qr/count latency: \d+ ns\./,
+	     qr/scan for 1 bit latency: \d+ ns\./,
+	     qr/scan for \d+ bits latency: \d+ ns\./);
@@ -0,0 +1,93 @@
+/* Stresses the page allocator and measures fragmentation.
+
+   The test keeps up to SLOT_CNT blocks of 1 to MAX_PAGES user
+   pages allocated, and for OP_CNT rounds picks a slot at random,
+   freeing its block if it has one and allocating a new block of
+   random size into it otherwise.  It reports the average cost of
+   an operation, then, with the blocks from the churn still
+   allocated, the largest contiguous run that can still be
+   allocated.  Run the same test against an older kernel to
+   compare. */
+
+#include <stdio.h>
+#include <random.h>
+#include "tests/threads/tests.h"
+#include "threads/palloc.h"
+#include "devices/timer.h"
+
+#define SLOT_CNT 128
+#define MAX_PAGES 8
+#define OP_CNT 50000
+
+struct block
+  {
+    void *pages;
+    size_t page_cnt;
+  };
+
+static struct block blocks[SLOT_CNT];
+
+static size_t largest_run (void);
+
+void
+test_bench_palloc (void) 
+{
+  int64_t start_ns, elapsed_ns;
+  size_t live_pages = 0;
+  int fail_cnt = 0;
+  int i;
+
+  random_init (0);
+  start_ns = timer_ns ();
+  for (i = 0; i < OP_CNT; i++) 
+    {
+      struct block *b = &blocks[random_ulong () % SLOT_CNT];
+      if (b->pages != NULL) 
+        {
+          palloc_free_multiple (b->pages, b->page_cnt);
+          live_pages -= b->page_cnt;
+          b->pages = NULL;
+        }
+      else 
+        {
+          b->page_cnt = random_ulong () % MAX_PAGES + 1;
+          b->pages = palloc_get_multiple (PAL_USER, b->page_cnt);
+          if (b->pages != NULL)
+            live_pages += b->page_cnt;
+          else
+            fail_cnt++;
+        }
+    }
+  elapsed_ns = timer_ns () - start_ns;
+
+  msg ("%d operations, %d allocations failed.", OP_CNT, fail_cnt);
+  msg ("palloc op latency: %lld ns.", elapsed_ns / OP_CNT);
+  msg ("largest free run with %zu pages in use: %zu pages.",
+       live_pages, largest_run ());
+
+  for (i = 0; i < SLOT_CNT; i++)
+    palloc_free_multiple (blocks[i].pages, blocks[i].page_cnt);
+  msg ("largest free run with no pages in use: %zu pages.", largest_run ());
+}
+
+/* Returns the largest number of contiguous user pages that can
+   be allocated. */
+static size_t
+largest_run (void) 
+{
+  size_t lo = 0, hi = 1 << 16;
+
+  while (lo < hi) 
+    {
+      size_t mid = (lo + hi + 1) / 2;
+      void *pages = palloc_get_multiple (PAL_USER, mid);
+      if (pages != NULL) 
+        {
+          palloc_free_multiple (pages, mid);
+          lo = mid;
+        }
+      else
+        hi = mid - 1;
+    }
+  return lo;
+}
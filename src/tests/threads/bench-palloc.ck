@@ -0,0 +1,7 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::threads::bench;
+check_bench (qr/palloc op latency: \d+ ns\./,
+	     qr/largest free run with \d+ pages in use: \d+ pages\./);
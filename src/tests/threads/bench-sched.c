@@ -0,0 +1,73 @@
+/* Measures the cost of a scheduling decision under whichever
+   scheduler the kernel was started with.
+
+   Creates THREAD_CNT threads, each of which calls thread_yield()
+   in a loop, and lets them run for BENCH_TICKS timer ticks while
+   the main thread sleeps.  Unlike bench-switch, this test does
+   not depend on priorities, so it runs unchanged as bench-sched
+   under the priority scheduler, bench-sched-mlfqs under the
+   MLFQS, and bench-sched-fair under the fair-share scheduler.
+   Compare the latencies that the three report. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 64
+#define BENCH_TICKS (5 * TIMER_FREQ)
+
+static thread_func yield_thread;
+
+/* Shared between the main thread and the workers. */
+static volatile bool done;
+static volatile long long yield_cnt;
+static struct semaphore exit_sema;
+
+void
+test_bench_sched (void) 
+{
+  const char *scheduler;
+  int64_t start_time, elapsed;
+  int i;
+
+  scheduler = thread_mlfqs ? "mlfqs" : thread_fair ? "fair" : "priority";
+  done = false;
+  yield_cnt = 0;
+  sema_init (&exit_sema, 0);
+
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "yield %d", i);
+      thread_create (name, PRI_DEFAULT, yield_thread, NULL);
+    }
+
+  msg ("%d threads yielding for %d ticks.", THREAD_CNT, BENCH_TICKS);
+  start_time = timer_ticks ();
+  timer_sleep (BENCH_TICKS);
+  elapsed = timer_elapsed (start_time);
+  done = true;
+
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down (&exit_sema);
+
+  if (yield_cnt == 0)
+    fail ("no thread ever yielded");
+  msg ("%lld yields in %lld ticks.", yield_cnt, elapsed);
+  msg ("%s scheduler latency: %lld ns.", scheduler,
+       elapsed * (1000000000 / TIMER_FREQ) / yield_cnt);
+}
+
+static void
+yield_thread (void *aux UNUSED) 
+{
+  while (!done) 
+    {
+      yield_cnt++;
+      thread_yield ();
+    }
+  sema_up (&exit_sema);
+}
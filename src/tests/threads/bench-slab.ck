@@ -0,0 +1,7 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::threads::bench;
+check_bench (qr/slab_alloc\+slab_free latency: \d+ ns\./,
+	     qr/malloc\+free latency: \d+ ns\./);
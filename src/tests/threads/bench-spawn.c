@@ -0,0 +1,52 @@
+/* Measures the cost of creating a thread and letting it exit.
+
+   The main thread creates ITER_CNT threads one after another,
+   each at a higher priority than itself, so that each new thread
+   runs, and exits, before thread_create() returns.  The reported
+   figure therefore covers the whole life of a thread that does
+   no work: allocating and initializing its page and stacks,
+   assigning its tid, two context switches, and freeing it again.
+   Run the same test against an older kernel to compare. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define ITER_CNT 20000
+
+static thread_func child_thread;
+
+void
+test_bench_spawn (void) 
+{
+  int64_t start_ns, elapsed_ns;
+  int run_cnt = 0;
+  int i;
+
+  start_ns = timer_ns ();
+  for (i = 0; i < ITER_CNT; i++) 
+    if (thread_create ("child", PRI_DEFAULT + 1, child_thread, &run_cnt)
+        == TID_ERROR)
+      fail ("thread_create() failed after %d threads", i);
+  elapsed_ns = timer_ns () - start_ns;
+
+  if (run_cnt != ITER_CNT)
+    fail ("%d threads created but %d ran", ITER_CNT, run_cnt);
+
+  msg ("%d threads created and exited in %lld us.",
+       ITER_CNT, elapsed_ns / 1000);
+  msg ("thread_create+exit latency: %lld ns.", elapsed_ns / ITER_CNT);
+  if (elapsed_ns > 0)
+    msg ("thread_create+exit: %lld round trips per second.",
+         ITER_CNT * 1000000000LL / elapsed_ns);
+}
+
+static void
+child_thread (void *run_cnt_) 
+{
+  int *run_cnt = run_cnt_;
+
+  (*run_cnt)++;
+}
@@ -0,0 +1,96 @@
+/* Measures the throughput of memcpy(), memset(), memcmp(), and
+   strlen() for blocks of several sizes, with word-aligned and
+   misaligned buffers.  Run the same test against an older kernel
+   to compare. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+/* Buffer size, in pages. */
+#define BUF_PAGES 17
+
+/* Bytes to process for each measurement. */
+#define TOTAL_BYTES (8 * 1024 * 1024)
+
+static const size_t sizes[] = {16, 64, 256, 4096, 65536};
+static const size_t aligns[] = {0, 1};
+
+enum op
+  {
+    OP_MEMCPY,
+    OP_MEMSET,
+    OP_MEMCMP,
+    OP_STRLEN
+  };
+
+static const char *op_names[] = {"memcpy", "memset", "memcmp", "strlen"};
+
+static unsigned char *src, *dst;
+static volatile size_t sink;
+
+static void run (enum op, size_t size, size_t align);
+
+void
+test_bench_string (void) 
+{
+  size_t i, j;
+  int op;
+
+  src = palloc_get_multiple (PAL_ASSERT, BUF_PAGES);
+  dst = palloc_get_multiple (PAL_ASSERT, BUF_PAGES);
+  memset (src, 'x', BUF_PAGES * PGSIZE);
+  memset (dst, 'x', BUF_PAGES * PGSIZE);
+
+  for (op = OP_MEMCPY; op <= OP_STRLEN; op++)
+    for (i = 0; i < sizeof sizes / sizeof *sizes; i++)
+      for (j = 0; j < sizeof aligns / sizeof *aligns; j++)
+        run (op, sizes[i], aligns[j]);
+
+  palloc_free_multiple (src, BUF_PAGES);
+  palloc_free_multiple (dst, BUF_PAGES);
+}
+
+/* Performs OP on blocks of SIZE bytes that start ALIGN bytes
+   past a page boundary, and reports its throughput. */
+static void
+run (enum op op, size_t size, size_t align) 
+{
+  unsigned char *s = src + align;
+  unsigned char *d = dst + align;
+  size_t iter_cnt = TOTAL_BYTES / size;
+  int64_t start_ns, elapsed_ns;
+  size_t i;
+
+  /* strlen() needs a terminator at the end of the block. */
+  if (op == OP_STRLEN)
+    s[size - 1] = '\0';
+
+  start_ns = timer_ns ();
+  for (i = 0; i < iter_cnt; i++)
+    switch (op) 
+      {
+      case OP_MEMCPY:
+        memcpy (d, s, size);
+        break;
+      case OP_MEMSET:
+        memset (d, i, size);
+        break;
+      case OP_MEMCMP:
+        sink = memcmp (d, s, size);
+        break;
+      case OP_STRLEN:
+        sink = strlen ((char *) s);
+        break;
+      }
+  elapsed_ns = timer_ns () - start_ns;
+
+  if (op == OP_STRLEN)
+    s[size - 1] = 'x';
+
+  msg ("%s %zu bytes at offset %zu: %lld MB/s.", op_names[op], size, align,
+       elapsed_ns > 0 ? (long long) TOTAL_BYTES * 1000 / elapsed_ns : 0);
+}
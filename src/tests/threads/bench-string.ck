@@ -0,0 +1,9 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::threads::bench;
+check_bench (qr/memcpy 4096 bytes at offset 0: \d+ MB\/s\./,
+	     qr/memset 4096 bytes at offset 0: \d+ MB\/s\./,
+	     qr/memcmp 4096 bytes at offset 0: \d+ MB\/s\./,
+	     qr/strlen 4096 bytes at offset 0: \d+ MB\/s\./);
@@ -0,0 +1,78 @@
+/* Measures the cost of a context switch with many runnable
+   threads.
+
+   Creates THREAD_CNT threads at the same priority, each of which
+   calls thread_yield() in a loop, and lets them run for
+   BENCH_TICKS timer ticks while the main thread sleeps.  Each
+   yield makes the scheduler pick the next thread from a run
+   queue holding every other worker, so a scheduler whose
+   selection cost grows with the number of runnable threads shows
+   up directly in the reported latency.  Run the same test against
+   an older kernel to compare. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 256
+#define BENCH_TICKS (5 * TIMER_FREQ)
+
+static thread_func yield_thread;
+
+/* Shared between the main thread and the workers. */
+static volatile bool done;
+static volatile long long switch_cnt;
+static struct semaphore exit_sema;
+
+void
+test_bench_switch (void) 
+{
+  int64_t start_time, elapsed;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  done = false;
+  switch_cnt = 0;
+  sema_init (&exit_sema, 0);
+
+  /* Keep the workers from running until they all exist. */
+  thread_set_priority (PRI_DEFAULT + 1);
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "yield %d", i);
+      thread_create (name, PRI_DEFAULT, yield_thread, NULL);
+    }
+
+  msg ("%d threads yielding for %d ticks.", THREAD_CNT, BENCH_TICKS);
+  start_time = timer_ticks ();
+  timer_sleep (BENCH_TICKS);
+  elapsed = timer_elapsed (start_time);
+  done = true;
+
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down (&exit_sema);
+  thread_set_priority (PRI_DEFAULT);
+
+  if (switch_cnt == 0)
+    fail ("no context switches happened");
+  msg ("%lld switches in %lld ticks.", switch_cnt, elapsed);
+  msg ("switch latency: %lld ns.",
+       elapsed * (1000000000 / TIMER_FREQ) / switch_cnt);
+}
+
+static void
+yield_thread (void *aux UNUSED) 
+{
+  while (!done) 
+    {
+      switch_cnt++;
+      thread_yield ();
+    }
+  sema_up (&exit_sema);
+}
@@ -0,0 +1,26 @@
+use strict;
+use warnings;
+use tests::tests;
+
+# Checks the output of a benchmark test.  Benchmark results vary
+# from run to run, so only require that the run completed
+# cleanly and that every line in @PATTERNS was reported.
+sub check_bench {
+    my (@patterns) = @_;
+    our ($test);
+    my (@output) = read_text_file ("$test.output");
+    common_checks ("run", @output);
+
+    my ($name) = $test =~ m%([^/]+)$%;
+    fail "missing \"($name) begin\" line\n"
+      if !grep (/^\($name\) begin$/, @output);
+    fail "missing \"($name) end\" line\n"
+      if !grep (/^\($name\) end$/, @output);
+    foreach my $pattern (@patterns) {
+	fail "missing benchmark result matching /$pattern/\n"
+	  if !grep (/$pattern/, @output);
+    }
+    pass;
+}
+
+1;
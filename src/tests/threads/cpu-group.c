@@ -0,0 +1,84 @@
+/* Checks CPU bandwidth control: a thread in a CPU group with a
+   quota of QUOTA ticks per PERIOD ticks spins next to a thread
+   in no group.  The grouped thread must not get more than its
+   quota, and the other thread must get the rest of the CPU. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/cpugroup.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define QUOTA 2
+#define PERIOD 10
+#define RUN_TICKS 200
+
+static thread_func spin_thread;
+
+/* Shared between the main thread and the spinners. */
+static volatile bool done;
+static struct semaphore exit_sema;
+
+struct spinner 
+  {
+    struct cpu_group *group;    /* Group to join, if any. */
+    int tick_cnt;               /* Ticks seen while running. */
+  };
+
+void
+test_cpu_group (void) 
+{
+  struct spinner runaway, batch;
+  long long consumed;
+
+  /* Equal priorities let the two threads take turns. */
+  ASSERT (!thread_mlfqs);
+
+  runaway.group = cpu_group_create (QUOTA, PERIOD);
+  if (runaway.group == NULL)
+    fail ("cpu_group_create() failed");
+  runaway.tick_cnt = 0;
+  batch.group = NULL;
+  batch.tick_cnt = 0;
+  done = false;
+  sema_init (&exit_sema, 0);
+
+  thread_create ("runaway", PRI_DEFAULT, spin_thread, &runaway);
+  thread_create ("batch", PRI_DEFAULT, spin_thread, &batch);
+  timer_sleep (RUN_TICKS);
+  done = true;
+  sema_down (&exit_sema);
+  sema_down (&exit_sema);
+
+  consumed = cpu_group_consumed (runaway.group);
+  if (consumed > RUN_TICKS * QUOTA / PERIOD + 2 * QUOTA)
+    fail ("group consumed %lld ticks, more than its quota of %d "
+          "per %d ticks allows", consumed, QUOTA, PERIOD);
+  if (runaway.tick_cnt == 0)
+    fail ("runaway thread never ran");
+  msg ("runaway thread stayed within its quota.");
+
+  if (batch.tick_cnt < RUN_TICKS * (PERIOD - QUOTA) / PERIOD - 2 * PERIOD)
+    fail ("other thread saw only %d ticks of %d", batch.tick_cnt, RUN_TICKS);
+  msg ("other thread got the rest of the CPU.");
+}
+
+static void
+spin_thread (void *spinner_) 
+{
+  struct spinner *s = spinner_;
+  int64_t last_time = 0;
+
+  if (s->group != NULL)
+    cpu_group_attach (thread_current (), s->group);
+  while (!done) 
+    {
+      int64_t cur_time = timer_ticks ();
+      if (cur_time != last_time)
+        s->tick_cnt++;
+      last_time = cur_time;
+    }
+  sema_up (&exit_sema);
+}
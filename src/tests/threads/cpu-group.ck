@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(cpu-group) begin
+(cpu-group) runaway thread stayed within its quota.
+(cpu-group) other thread got the rest of the CPU.
+(cpu-group) end
+EOF
+pass;
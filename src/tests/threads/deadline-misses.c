@@ -0,0 +1,114 @@
+/* Checks the deadline scheduling class under background load.
+
+   Two threads at PRI_MAX spin for the whole test.  Next to them,
+   a thread in the deadline class with a budget of 3 ticks every
+   10 ticks runs JOB_CNT jobs of about a tick each, which it
+   should finish without missing a single deadline, since the
+   deadline class runs ahead of every priority.  A second thread,
+   admitted with a budget of 2 ticks every 10 ticks, runs jobs of
+   5 ticks each, which cannot meet their deadlines; its overruns
+   must be counted as misses and must not make the first thread
+   miss.  Finally, admission control must refuse a third thread
+   that would take the class over its limit. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define JOB_CNT 20
+#define OVERRUN_JOB_CNT 5
+#define SPINNER_CNT 2
+
+struct periodic 
+  {
+    int runtime;                /* Budget per period, in ticks. */
+    int period;                 /* Period, in ticks. */
+    int job_cnt;                /* Number of jobs to run. */
+    int job_ticks;              /* Ticks that each job spins for. */
+    long long misses;           /* Deadlines missed. */
+  };
+
+static thread_func periodic_thread;
+static thread_func spin_thread;
+
+/* Shared between the main thread and the others. */
+static volatile bool done;
+static struct semaphore admitted;
+static struct semaphore exit_sema;
+
+void
+test_deadline_misses (void) 
+{
+  struct periodic good = {3, 10, JOB_CNT, 1, 0};
+  struct periodic overrun = {2, 10, OVERRUN_JOB_CNT, 5, 0};
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  done = false;
+  sema_init (&admitted, 0);
+  sema_init (&exit_sema, 0);
+
+  /* Run at PRI_MAX too, so that the spinners cannot starve us
+     or the threads that have yet to enter the deadline class. */
+  thread_set_priority (PRI_MAX);
+  thread_create ("good", PRI_MAX, periodic_thread, &good);
+  thread_create ("overrun", PRI_MAX, periodic_thread, &overrun);
+  for (i = 0; i < SPINNER_CNT; i++)
+    thread_create ("spinner", PRI_MAX, spin_thread, NULL);
+
+  sema_down (&admitted);
+  sema_down (&admitted);
+  if (thread_set_deadline (6, 10))
+    fail ("admission control accepted more than the CPU can do");
+  msg ("admission control refused an over-budget thread.");
+
+  sema_down (&exit_sema);
+  sema_down (&exit_sema);
+  done = true;
+  for (i = 0; i < SPINNER_CNT; i++)
+    sema_down (&exit_sema);
+  thread_set_priority (PRI_DEFAULT);
+
+  msg ("good thread ran %d jobs with %lld deadline misses.",
+       good.job_cnt, good.misses);
+  if (overrun.misses == 0)
+    fail ("overrunning thread missed no deadlines");
+  msg ("overrunning thread missed its deadlines.");
+}
+
+static void
+periodic_thread (void *p_) 
+{
+  struct periodic *p = p_;
+  int i;
+
+  if (!thread_set_deadline (p->runtime, p->period))
+    fail ("thread with budget %d of %d ticks not admitted",
+          p->runtime, p->period);
+  sema_up (&admitted);
+
+  for (i = 0; i < p->job_cnt; i++) 
+    {
+      int64_t start = timer_ticks ();
+      while (timer_elapsed (start) < p->job_ticks)
+        continue;
+      thread_deadline_wait ();
+    }
+  p->misses = thread_get_deadline_misses ();
+
+  thread_set_deadline (0, 0);
+  sema_up (&exit_sema);
+}
+
+static void
+spin_thread (void *aux UNUSED) 
+{
+  while (!done)
+    continue;
+  sema_up (&exit_sema);
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(deadline-misses) begin
+(deadline-misses) admission control refused an over-budget thread.
+(deadline-misses) good thread ran 20 jobs with 0 deadline misses.
+(deadline-misses) overrunning thread missed its deadlines.
+(deadline-misses) end
+EOF
+pass;
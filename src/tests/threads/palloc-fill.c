@@ -0,0 +1,83 @@
+/* Checks that the kernel finds and uses a large amount of RAM.
+
+   The test is run with 512 MB of RAM.  It allocates user pages,
+   and then kernel pages, until none are left, writing each page's
+   own address into it and chaining the pages into a list through
+   their first word.  Then it checks that every page still holds
+   what was written, which fails if two pages are aliases for the
+   same memory, and frees them all. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/loader.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Minimum amount of memory, in MB, that must be found. */
+#define MIN_MB 480
+
+/* Header at the start of each allocated page. */
+struct page
+  {
+    struct page *next;
+    void *self;
+  };
+
+static struct page *fill (enum palloc_flags, size_t *page_cnt);
+
+void
+test_palloc_fill (void) 
+{
+  struct page *user, *kernel, *p;
+  size_t user_cnt, kernel_cnt;
+
+  if (init_ram_pages < MIN_MB * (1024 * 1024 / PGSIZE))
+    fail ("only %zu MB of RAM detected",
+          (size_t) init_ram_pages / (1024 * 1024 / PGSIZE));
+
+  user = fill (PAL_USER, &user_cnt);
+  kernel = fill (0, &kernel_cnt);
+  if (user_cnt + kernel_cnt < MIN_MB * (1024 * 1024 / PGSIZE))
+    fail ("only %zu pages allocated", user_cnt + kernel_cnt);
+  msg ("allocated more than %d MB of pages.", MIN_MB);
+
+  for (p = user; p != NULL; p = p->next)
+    if (p->self != p)
+      fail ("user page %p was overwritten", p);
+  for (p = kernel; p != NULL; p = p->next)
+    if (p->self != p)
+      fail ("kernel page %p was overwritten", p);
+  msg ("every page kept its contents.");
+
+  while (user != NULL) 
+    {
+      p = user;
+      user = p->next;
+      palloc_free_page (p);
+    }
+  while (kernel != NULL) 
+    {
+      p = kernel;
+      kernel = p->next;
+      palloc_free_page (p);
+    }
+}
+
+/* Allocates pages with FLAGS until none are left, and returns
+   them as a list.  Stores the number of pages in *PAGE_CNT. */
+static struct page *
+fill (enum palloc_flags flags, size_t *page_cnt) 
+{
+  struct page *list = NULL;
+  struct page *p;
+
+  *page_cnt = 0;
+  while ((p = palloc_get_page (flags)) != NULL) 
+    {
+      p->next = list;
+      p->self = p;
+      list = p;
+      (*page_cnt)++;
+    }
+  return list;
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(palloc-fill) begin
+(palloc-fill) allocated more than 480 MB of pages.
+(palloc-fill) every page kept its contents.
+(palloc-fill) end
+EOF
+pass;
@@ -0,0 +1,74 @@
+/* Creates READER_CNT threads that each acquire a readers-writer
+   lock for reading and then sleep while holding it.  All of them
+   should hold the lock at the same time, so the whole test takes
+   about as long as a single reader, where an ordinary lock would
+   make it READER_CNT times as long. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define READER_CNT 8
+#define HOLD_TICKS 20
+
+static thread_func reader_thread;
+
+static struct rwlock rwlock;
+static struct semaphore done_sema;
+static int inside_cnt, max_inside_cnt;
+
+void
+test_rwlock_readers (void) 
+{
+  int64_t start_time, elapsed;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  rwlock_init (&rwlock);
+  sema_init (&done_sema, 0);
+  inside_cnt = max_inside_cnt = 0;
+
+  start_time = timer_ticks ();
+  for (i = 0; i < READER_CNT; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "reader %d", i);
+      thread_create (name, PRI_DEFAULT, reader_thread, NULL);
+    }
+  for (i = 0; i < READER_CNT; i++)
+    sema_down (&done_sema);
+  elapsed = timer_elapsed (start_time);
+
+  msg ("%d readers held the lock at the same time.", max_inside_cnt);
+  if (elapsed >= 2 * HOLD_TICKS)
+    fail ("readers took %lld ticks, should be about %d",
+          elapsed, HOLD_TICKS);
+}
+
+static void
+reader_thread (void *aux UNUSED) 
+{
+  enum intr_level old_level;
+
+  rwlock_acquire_read (&rwlock);
+
+  old_level = intr_disable ();
+  if (++inside_cnt > max_inside_cnt)
+    max_inside_cnt = inside_cnt;
+  intr_set_level (old_level);
+
+  timer_sleep (HOLD_TICKS);
+
+  old_level = intr_disable ();
+  inside_cnt--;
+  intr_set_level (old_level);
+
+  rwlock_release_read (&rwlock);
+  sema_up (&done_sema);
+}
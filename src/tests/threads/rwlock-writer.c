@@ -0,0 +1,56 @@
+/* The main thread holds a readers-writer lock for reading.  A
+   higher-priority writer then blocks waiting for it, followed by
+   an even higher-priority reader.  Although the lock is held only
+   by readers, the new reader must wait behind the writer, and
+   while it does so it donates its priority to the writer.
+
+   When the main thread releases the lock, the writer should get
+   it first, at the reader's priority, and then the reader. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func writer_thread;
+static thread_func reader_thread;
+
+static struct rwlock rwlock;
+
+void
+test_rwlock_writer (void) 
+{
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&rwlock);
+  rwlock_acquire_read (&rwlock);
+  thread_create ("writer", PRI_DEFAULT + 1, writer_thread, NULL);
+  thread_create ("reader", PRI_DEFAULT + 2, reader_thread, NULL);
+  msg ("main: releasing the read lock.");
+  rwlock_release_read (&rwlock);
+  msg ("main: done.");
+}
+
+static void
+writer_thread (void *aux UNUSED) 
+{
+  msg ("writer: waiting for the lock.");
+  rwlock_acquire_write (&rwlock);
+  msg ("writer: got the lock with priority %d.", thread_get_priority ());
+  rwlock_release_write (&rwlock);
+  msg ("writer: done.");
+}
+
+static void
+reader_thread (void *aux UNUSED) 
+{
+  msg ("reader: waiting for the lock.");
+  rwlock_acquire_read (&rwlock);
+  msg ("reader: got the lock.");
+  rwlock_release_read (&rwlock);
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-writer) begin
+(rwlock-writer) writer: waiting for the lock.
+(rwlock-writer) reader: waiting for the lock.
+(rwlock-writer) main: releasing the read lock.
+(rwlock-writer) writer: got the lock with priority 33.
+(rwlock-writer) reader: got the lock.
+(rwlock-writer) writer: done.
+(rwlock-writer) main: done.
+(rwlock-writer) end
+EOF
+pass;
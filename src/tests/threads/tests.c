@@ -17,6 +17,9 @@ static const struct test tests[] =
     {"alarm-priority", test_alarm_priority},
     {"alarm-zero", test_alarm_zero},
     {"alarm-negative", test_alarm_negative},
+    {"alarm-thousands", test_alarm_thousands},
+    {"alarm-slack", test_alarm_slack},
+    {"alarm-tickless", test_alarm_tickless},
     {"priority-change", test_priority_change},
     {"priority-donate-one", test_priority_donate_one},
     {"priority-donate-multiple", test_priority_donate_multiple},
@@ -25,6 +28,11 @@ static const struct test tests[] =
     {"priority-donate-sema", test_priority_donate_sema},
     {"priority-donate-lower", test_priority_donate_lower},
     {"priority-donate-chain", test_priority_donate_chain},
+    {"rwlock-readers", test_rwlock_readers},
+    {"rwlock-writer", test_rwlock_writer},
+    {"workqueue", test_workqueue},
+    {"cpu-group", test_cpu_group},
+    {"deadline-misses", test_deadline_misses},
     {"priority-fifo", test_priority_fifo},
     {"priority-preempt", test_priority_preempt},
     {"priority-sema", test_priority_sema},
@@ -38,6 +46,20 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"bench-switch", test_bench_switch},
+    {"bench-donate", test_bench_donate},
+    {"bench-spawn", test_bench_spawn},
+    {"bench-sched", test_bench_sched},
+    {"bench-sched-mlfqs", test_bench_sched},
+    {"fair-2", test_fair_2},
+    {"fair-nice-2", test_fair_nice_2},
+    {"fair-nice-10", test_fair_nice_10},
+    {"bench-sched-fair", test_bench_sched},
+    {"bench-slab", test_bench_slab},
+    {"bench-palloc", test_bench_palloc},
+    {"bench-bitmap", test_bench_bitmap},
+    {"palloc-fill", test_palloc_fill},
+    {"bench-string", test_bench_string},
   };
 
 static const char *test_name;
@@ -11,6 +11,9 @@ extern test_func test_alarm_simultaneous;
 extern test_func test_alarm_priority;
 extern test_func test_alarm_zero;
 extern test_func test_alarm_negative;
+extern test_func test_alarm_thousands;
+extern test_func test_alarm_slack;
+extern test_func test_alarm_tickless;
 extern test_func test_priority_change;
 extern test_func test_priority_donate_one;
 extern test_func test_priority_donate_multiple;
@@ -19,6 +22,11 @@ extern test_func test_priority_donate_sema;
 extern test_func test_priority_donate_nest;
 extern test_func test_priority_donate_lower;
 extern test_func test_priority_donate_chain;
+extern test_func test_rwlock_readers;
+extern test_func test_rwlock_writer;
+extern test_func test_workqueue;
+extern test_func test_cpu_group;
+extern test_func test_deadline_misses;
 extern test_func test_priority_fifo;
 extern test_func test_priority_preempt;
 extern test_func test_priority_sema;
@@ -32,6 +40,18 @@ extern test_func test_mlfqs_fair_20;
 extern test_func test_mlfqs_nice_2;
 extern test_func test_mlfqs_nice_10;
 extern test_func test_mlfqs_block;
+extern test_func test_bench_switch;
+extern test_func test_bench_donate;
+extern test_func test_bench_spawn;
+extern test_func test_bench_sched;
+extern test_func test_bench_slab;
+extern test_func test_bench_palloc;
+extern test_func test_bench_bitmap;
+extern test_func test_palloc_fill;
+extern test_func test_bench_string;
+extern test_func test_fair_2;
+extern test_func test_fair_nice_2;
+extern test_func test_fair_nice_10;
 
 void msg (const char *, ...);
 void fail (const char *, ...);
@@ -0,0 +1,81 @@
+/* Checks the kernel work queue: items submitted from a thread
+   are run by the worker threads and can be waited for, an item
+   cannot be queued twice, delayed items do not run early, and
+   cancelled items do not run at all. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+#include "devices/timer.h"
+
+#define ITEM_CNT 16
+#define DELAY_TICKS 10
+
+static work_func count_work;
+static work_func stamp_work;
+
+static int run_cnt;
+static int64_t run_tick;
+
+void
+test_workqueue (void) 
+{
+  struct work items[ITEM_CNT];
+  struct work w;
+  int64_t start;
+  int i;
+
+  /* Immediate work. */
+  run_cnt = 0;
+  for (i = 0; i < ITEM_CNT; i++) 
+    {
+      work_init (&items[i], count_work, NULL);
+      if (!work_submit (&items[i]))
+        fail ("item %d could not be submitted", i);
+    }
+  for (i = 0; i < ITEM_CNT; i++) 
+    {
+      work_wait (&items[i]);
+      if (work_pending (&items[i]))
+        fail ("item %d still pending after work_wait()", i);
+    }
+  msg ("%d items run.", run_cnt);
+
+  /* Delayed work. */
+  work_init (&w, stamp_work, NULL);
+  start = timer_ticks ();
+  work_submit_delayed (&w, DELAY_TICKS);
+  if (work_submit (&w))
+    fail ("delayed item was queued twice");
+  work_wait (&w);
+  if (run_tick - start < DELAY_TICKS)
+    fail ("delayed item ran after %lld ticks instead of %d",
+          run_tick - start, DELAY_TICKS);
+  msg ("delayed item ran after at least %d ticks.", DELAY_TICKS);
+
+  /* Cancelled work. */
+  run_cnt = 0;
+  work_init (&w, count_work, NULL);
+  work_submit_delayed (&w, DELAY_TICKS);
+  if (!work_cancel (&w))
+    fail ("delayed item could not be cancelled");
+  if (work_cancel (&w))
+    fail ("idle item was cancelled");
+  work_wait (&w);
+  timer_sleep (2 * DELAY_TICKS);
+  msg ("cancelled item ran %d times.", run_cnt);
+}
+
+static void
+count_work (void *aux UNUSED) 
+{
+  run_cnt++;
+}
+
+static void
+stamp_work (void *aux UNUSED) 
+{
+  run_tick = timer_ticks ();
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(workqueue) begin
+(workqueue) 16 items run.
+(workqueue) delayed item ran after at least 10 ticks.
+(workqueue) cancelled item ran 0 times.
+(workqueue) end
+EOF
+pass;
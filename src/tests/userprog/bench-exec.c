@@ -0,0 +1,45 @@
+/* Measures the cost of exec() followed by wait() on a child that
+   exits at once.
+
+   User programs have no clock, so the time is measured with the
+   processor's time-stamp counter and reported in cycles.  The
+   figure covers the whole round trip: creating the child's
+   thread and process control block, loading its executable,
+   running it to exit, and reaping it.  Run the same test against
+   an older kernel to compare. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ITER_CNT 64
+
+/* Returns the time-stamp counter. */
+static uint64_t
+rdtsc (void) 
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+void
+test_main (void) 
+{
+  uint64_t start, elapsed;
+  int i;
+
+  start = rdtsc ();
+  for (i = 0; i < ITER_CNT; i++) 
+    {
+      pid_t pid = exec ("child-simple");
+      if (pid == -1)
+        fail ("exec() failed after %d children", i);
+      if (wait (pid) != 81)
+        fail ("child %d returned a wrong exit status", i);
+    }
+  elapsed = rdtsc () - start;
+
+  msg ("exec+wait latency: %llu cycles.", elapsed / ITER_CNT);
+}
@@ -0,0 +1,23 @@
+/* Limits the process's CPU time and checks that limits it may
+   not set are refused: a share of more than the whole CPU, and,
+   once limited, a larger share than before.  Then burns CPU time
+   under the limit, which must still make progress. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  volatile int i;
+
+  CHECK (!cpu_limit (11, 10), "refuse quota longer than period");
+  CHECK (!cpu_limit (0, 10), "refuse empty quota");
+  CHECK (cpu_limit (5, 10), "limit to half the CPU");
+  CHECK (!cpu_limit (8, 10), "refuse raising the limit");
+  CHECK (cpu_limit (2, 10), "lower the limit");
+  for (i = 0; i < 20000000; i++)
+    continue;
+  msg ("ran under the limit");
+}
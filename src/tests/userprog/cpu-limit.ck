@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(cpu-limit) begin
+(cpu-limit) refuse quota longer than period
+(cpu-limit) refuse empty quota
+(cpu-limit) limit to half the CPU
+(cpu-limit) refuse raising the limit
+(cpu-limit) lower the limit
+(cpu-limit) ran under the limit
+(cpu-limit) end
+cpu-limit: exit(0)
+EOF
+pass;
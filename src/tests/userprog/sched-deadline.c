@@ -0,0 +1,26 @@
+/* Enters the deadline scheduling class, runs a few periodic
+   jobs, and leaves it again.  Budgets that the class cannot
+   admit must be refused. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define JOB_CNT 5
+
+void
+test_main (void) 
+{
+  int i, misses = 0;
+
+  CHECK (!sched_deadline (11, 10), "refuse budget longer than period");
+  CHECK (!sched_deadline (10, 10), "refuse whole CPU");
+  CHECK (sched_wait_period () == -1, "wait outside deadline class");
+  CHECK (sched_deadline (2, 10), "enter deadline class");
+  for (i = 0; i < JOB_CNT; i++)
+    misses = sched_wait_period ();
+  if (misses != 0)
+    fail ("missed %d deadlines", misses);
+  msg ("ran %d jobs without missing a deadline", JOB_CNT);
+  CHECK (sched_deadline (0, 0), "leave deadline class");
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(sched-deadline) begin
+(sched-deadline) refuse budget longer than period
+(sched-deadline) refuse whole CPU
+(sched-deadline) wait outside deadline class
+(sched-deadline) enter deadline class
+(sched-deadline) ran 5 jobs without missing a deadline
+(sched-deadline) leave deadline class
+(sched-deadline) end
+sched-deadline: exit(0)
+EOF
+pass;
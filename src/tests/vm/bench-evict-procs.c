@@ -0,0 +1,48 @@
+/* Measures paging throughput with many processes competing for
+   memory.
+
+   Runs 56 child-evict processes at once.  Together their arrays
+   exceed the user pool, so frames are evicted from processes
+   other than the one taking the fault.  The mean cost per page
+   touched is reported in cycles of the time-stamp counter; the
+   kernel's statistics at shutdown give the mean time per
+   eviction. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHILD_CNT 56
+#define CHILD_PAGE_CNT 24
+#define CHILD_SWEEP_CNT 4
+
+/* Returns the time-stamp counter. */
+static uint64_t
+rdtsc (void) 
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+void
+test_main (void)
+{
+  pid_t children[CHILD_CNT];
+  uint64_t start, elapsed;
+  int i;
+
+  quiet = true;
+  start = rdtsc ();
+  for (i = 0; i < CHILD_CNT; i++) 
+    CHECK ((children[i] = exec ("child-evict")) != -1,
+           "exec \"child-evict\"");
+  for (i = 0; i < CHILD_CNT; i++) 
+    CHECK (wait (children[i]) == 0x42, "wait for child %d", i);
+  elapsed = rdtsc () - start;
+  quiet = false;
+
+  msg ("%d processes paging: %llu cycles per page.", CHILD_CNT,
+       elapsed / (CHILD_CNT * CHILD_PAGE_CNT * (CHILD_SWEEP_CNT + 1)));
+}
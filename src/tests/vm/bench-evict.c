@@ -0,0 +1,47 @@
+/* Measures paging throughput when the working set exceeds RAM.
+
+   Writes every page of a 2 MB array, which is more than the user
+   pool holds, and then sweeps it twice more.  Each sweep evicts
+   pages to make room for the ones it touches, so the figure is
+   dominated by the cost of choosing and evicting a victim frame.
+   The mean cost per page of the later sweeps is reported in
+   cycles of the time-stamp counter; the kernel's statistics at
+   shutdown give the number of frames evicted. */
+
+#include <stdint.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_CNT 512
+#define SWEEP_CNT 2
+
+static volatile char buf[PAGE_CNT][4096];
+
+/* Returns the time-stamp counter. */
+static uint64_t
+rdtsc (void) 
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+void
+test_main (void) 
+{
+  uint64_t start, elapsed;
+  int sweep, i;
+
+  for (i = 0; i < PAGE_CNT; i++)
+    buf[i][0] = i;
+
+  start = rdtsc ();
+  for (sweep = 0; sweep < SWEEP_CNT; sweep++)
+    for (i = 0; i < PAGE_CNT; i++)
+      if (buf[i][0] != (char) i)
+        fail ("page %d has the wrong contents", i);
+  elapsed = rdtsc () - start;
+
+  msg ("paging under memory pressure: %llu cycles per page.",
+       elapsed / (SWEEP_CNT * PAGE_CNT));
+}
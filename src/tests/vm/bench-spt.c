@@ -0,0 +1,58 @@
+/* Measures how the cost of a page fault varies with the size of
+   the supplemental page table.
+
+   Touches each page of a large zero-initialized array once, in
+   order, so that every access faults in a page that the loader
+   recorded when the program started.  The mean fault latency for
+   the first and for the last group of pages is reported in cycles
+   of the time-stamp counter.  The two figures should be close: a
+   lookup should not get slower the further its page lies from the
+   start of the table. */
+
+#include <stdint.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_CNT 1024
+#define GROUP_CNT 64
+
+static volatile char big[PAGE_CNT][4096];
+
+/* Returns the time-stamp counter. */
+static uint64_t
+rdtsc (void) 
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+/* Faults in GROUP_CNT pages starting at page FIRST and returns
+   the mean cycles per fault. */
+static uint64_t
+fault_group (int first) 
+{
+  uint64_t start;
+  int i;
+
+  start = rdtsc ();
+  for (i = first; i < first + GROUP_CNT; i++)
+    if (big[i][0] != 0)
+      fail ("page %d is not zeroed", i);
+  return (rdtsc () - start) / GROUP_CNT;
+}
+
+void
+test_main (void) 
+{
+  uint64_t first, last;
+  int i;
+
+  first = fault_group (0);
+  for (i = GROUP_CNT; i < PAGE_CNT - GROUP_CNT; i++)
+    big[i][0] = 1;
+  last = fault_group (PAGE_CNT - GROUP_CNT);
+
+  msg ("first %d pages: %llu cycles per fault.", GROUP_CNT, first);
+  msg ("last %d pages: %llu cycles per fault.", GROUP_CNT, last);
+}
@@ -0,0 +1,7 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::threads::bench;
+check_bench (qr/first \d+ pages: \d+ cycles per fault\./,
+	     qr/last \d+ pages: \d+ cycles per fault\./);
@@ -0,0 +1,29 @@
+/* Child process of bench-evict-procs.
+   Writes each page of a 96 kB array and then reads every page
+   back several times, so that with many copies running at once
+   the pages are evicted and brought back repeatedly. */
+
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_CNT 24
+#define SWEEP_CNT 4
+
+static volatile char buf[PAGE_CNT][4096];
+
+int
+main (void)
+{
+  int sweep, i;
+
+  test_name = "child-evict";
+
+  for (i = 0; i < PAGE_CNT; i++)
+    buf[i][0] = i;
+  for (sweep = 0; sweep < SWEEP_CNT; sweep++)
+    for (i = 0; i < PAGE_CNT; i++)
+      if (buf[i][0] != (char) i)
+        fail ("page %d has the wrong contents", i);
+
+  return 0x42;
+}
@@ -0,0 +1,209 @@
+#include "threads/cpugroup.h"
+#include <debug.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* CPU bandwidth control.
+
+   thread_tick() charges each tick to the group of the running
+   thread, if it has one, and preempts the thread when that uses
+   up the group's quota.  From then until the end of the period,
+   a thread of the group that would be put in the run queue is
+   parked on the group's list instead, in the THREAD_PARKED
+   state, and the timer interrupt makes the parked threads ready
+   through cpu_group_expire() when the period ends.  Only throttled groups
+   have a deadline to watch for, so other groups cost nothing
+   between ticks that they are charged for.
+
+   All of this state is protected by disabling interrupts. */
+
+/* All groups, and the groups that are throttled. */
+static struct list all_groups = LIST_INITIALIZER(all_groups);
+static struct list throttled_groups = LIST_INITIALIZER(throttled_groups);
+
+static void refill(struct cpu_group *, int64_t now);
+
+/* Creates and returns a group whose threads may run for QUOTA
+   timer ticks in every PERIOD ticks, or returns a null pointer
+   if memory is not available.  The group starts out empty and is
+   never destroyed. */
+struct cpu_group *
+cpu_group_create(int64_t quota, int64_t period)
+{
+    static int next_id = 1;
+    struct cpu_group *g;
+    enum intr_level old_level;
+
+    g = malloc(sizeof *g);
+    if (g == NULL)
+        return NULL;
+
+    g->used = 0;
+    g->consumed = 0;
+    g->throttle_cnt = 0;
+    g->throttled = false;
+    list_init(&g->parked);
+
+    old_level = intr_disable();
+    g->id = next_id++;
+    g->period_end = 0;
+    cpu_group_set_limit(g, quota, period);
+    list_push_back(&all_groups, &g->elem);
+    intr_set_level(old_level);
+
+    return g;
+}
+
+/* Changes G's budget to QUOTA ticks in every PERIOD ticks,
+   starting a new period now. */
+void cpu_group_set_limit(struct cpu_group *g, int64_t quota, int64_t period)
+{
+    enum intr_level old_level;
+
+    ASSERT(g != NULL);
+    ASSERT(quota > 0 && period > 0);
+
+    old_level = intr_disable();
+    g->quota = quota;
+    g->period = period;
+    g->used = 0;
+    g->period_end = timer_ticks() + period;
+    intr_set_level(old_level);
+}
+
+/* Moves thread T into group G, or out of any group if G is a
+   null pointer.  Threads that T creates from now on start out in
+   G too. */
+void cpu_group_attach(struct thread *t, struct cpu_group *g)
+{
+    enum intr_level old_level = intr_disable();
+    t->cpu_group = g;
+    intr_set_level(old_level);
+}
+
+/* Returns the number of timer ticks that the threads in G have
+   run for, in total. */
+long long
+cpu_group_consumed(const struct cpu_group *g)
+{
+    enum intr_level old_level = intr_disable();
+    long long consumed = g->consumed;
+    intr_set_level(old_level);
+    return consumed;
+}
+
+/* Charges the timer tick NOW, during which thread T ran, to T's
+   group.  Returns true if the group is throttled, in which case
+   T should be preempted.  Called by thread_tick(). */
+bool cpu_group_charge(struct thread *t, int64_t now)
+{
+    struct cpu_group *g = t->cpu_group;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (g == NULL)
+        return false;
+
+    if (!g->throttled && now >= g->period_end)
+        refill(g, now);
+    g->used++;
+    g->consumed++;
+    if (!g->throttled && g->used >= g->quota)
+    {
+        g->throttled = true;
+        g->throttle_cnt++;
+        list_push_back(&throttled_groups, &g->throttled_elem);
+    }
+    return g->throttled;
+}
+
+/* If T's group is throttled, parks T on the group's list and
+   returns true.  The caller must then put T in the THREAD_PARKED
+   state, where it stays until the group is refilled.  Otherwise,
+   returns false and does nothing.
+
+   A thread that holds locks is not parked, because priority
+   donation could not lift the inversion that would cause: it
+   runs on over its quota, preempted at every tick, until it
+   releases them. */
+bool cpu_group_park(struct thread *t)
+{
+    struct cpu_group *g = t->cpu_group;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (g == NULL || !g->throttled || !heap_empty(&t->held_locks))
+        return false;
+    list_push_back(&g->parked, &t->elem);
+    return true;
+}
+
+/* Refills each throttled group whose period has ended by tick
+   NOW and unblocks its parked threads.  Called by the timer
+   interrupt at every tick. */
+void cpu_group_expire(int64_t now)
+{
+    struct list_elem *e = list_begin(&throttled_groups);
+
+    while (e != list_end(&throttled_groups))
+    {
+        struct cpu_group *g = list_entry(e, struct cpu_group, throttled_elem);
+
+        e = list_next(e);
+        if (now < g->period_end)
+            continue;
+
+        list_remove(&g->throttled_elem);
+        g->throttled = false;
+        refill(g, now);
+        while (!list_empty(&g->parked))
+            thread_unpark(list_entry(list_pop_front(&g->parked),
+                                     struct thread, elem));
+    }
+}
+
+/* Returns the earliest tick at which a throttled group is
+   refilled, or INT64_MAX if no group is throttled. */
+int64_t
+cpu_group_next_refill(void)
+{
+    struct list_elem *e;
+    int64_t next = INT64_MAX;
+
+    for (e = list_begin(&throttled_groups); e != list_end(&throttled_groups);
+         e = list_next(e))
+    {
+        struct cpu_group *g = list_entry(e, struct cpu_group, throttled_elem);
+        if (g->period_end < next)
+            next = g->period_end;
+    }
+    return next;
+}
+
+/* Prints CPU usage statistics for each group. */
+void cpu_group_print_stats(void)
+{
+    struct list_elem *e;
+
+    for (e = list_begin(&all_groups); e != list_end(&all_groups);
+         e = list_next(e))
+    {
+        struct cpu_group *g = list_entry(e, struct cpu_group, elem);
+        printf("CPU group %d: %lld ticks consumed, throttled %lld times "
+               "(quota %lld of %lld ticks)\n",
+               g->id, g->consumed, g->throttle_cnt,
+               (long long)g->quota, (long long)g->period);
+    }
+}
+
+/* Starts a new period for G, whose previous one ended by tick
+   NOW, keeping the period boundaries where they were. */
+static void
+refill(struct cpu_group *g, int64_t now)
+{
+    g->used = 0;
+    g->period_end += (now - g->period_end) / g->period * g->period + g->period;
+}
@@ -0,0 +1,42 @@
+#ifndef THREADS_CPUGROUP_H
+#define THREADS_CPUGROUP_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+struct thread;
+
+/* A CPU bandwidth group.  The threads in a group may run for a
+   total of QUOTA timer ticks in every PERIOD ticks; once they
+   have, the group is throttled and none of them runs again until
+   the period ends.  A thread joins the group of the thread that
+   creates it, so all the threads and child processes started by
+   a process share its group. */
+struct cpu_group
+{
+    int id;                          /* Group identifier. */
+    int64_t quota;                   /* Ticks the group may run per period. */
+    int64_t period;                  /* Length of a period, in ticks. */
+    int64_t period_end;              /* Tick at which the period ends. */
+    int64_t used;                    /* Ticks used in this period. */
+    long long consumed;              /* Ticks used in total. */
+    long long throttle_cnt;          /* Number of times throttled. */
+    bool throttled;                  /* Quota used up for this period? */
+    struct list parked;              /* Threads kept off the run queue. */
+    struct list_elem elem;           /* Element in list of all groups. */
+    struct list_elem throttled_elem; /* Element in list of throttled groups. */
+};
+
+struct cpu_group *cpu_group_create(int64_t quota, int64_t period);
+void cpu_group_set_limit(struct cpu_group *, int64_t quota, int64_t period);
+void cpu_group_attach(struct thread *, struct cpu_group *);
+long long cpu_group_consumed(const struct cpu_group *);
+
+bool cpu_group_charge(struct thread *, int64_t now);
+bool cpu_group_park(struct thread *);
+void cpu_group_expire(int64_t now);
+int64_t cpu_group_next_refill(void);
+void cpu_group_print_stats(void);
+
+#endif /* threads/cpugroup.h */
@@ -22,6 +22,7 @@
 #include "threads/palloc.h"
 #include "threads/pte.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -38,6 +39,7 @@
 #include "filesys/fsutil.h"
 #endif
 #include "vm/frame.h"
+#include "vm/mmap.h"
 #include "vm/swap.h"
 
 /* Page directory with kernel mappings only. */
@@ -99,9 +101,13 @@ int main(void)
     palloc_init(user_page_limit);
     malloc_init();
     paging_init();
+    palloc_init_high();
 
     frame_table_init();
-    swap_table_init();
+#ifdef VM
+    spt_init();
+    mmap_init();
+#endif
 
 
     /* Segmentation. */
@@ -122,6 +128,7 @@ int main(void)
 
     /* Start thread scheduler and enable interrupts. */
     thread_start();
+    workqueue_init();
     serial_init_queue();
     timer_calibrate();
 
@@ -130,6 +137,7 @@ int main(void)
     ide_init();
     locate_block_devices();
     filesys_init(format_filesys);
+    swap_table_init();
 #endif
 
     printf("Boot complete.\n");
@@ -263,6 +271,16 @@ parse_options(char **argv)
             random_init(atoi(value));
         else if (!strcmp(name, "-mlfqs"))
             thread_mlfqs = true;
+        else if (!strcmp(name, "-fair"))
+            thread_fair = true;
+        else if (!strcmp(name, "-tickless"))
+            timer_tickless = true;
+        else if (!strcmp(name, "-no-prezero"))
+            palloc_prezero = false;
+        else if (!strcmp(name, "-lend-min"))
+            palloc_lend_min = atoi(value);
+        else if (!strcmp(name, "-lend-max"))
+            palloc_lend_max = atoi(value);
 #ifdef USERPROG
         else if (!strcmp(name, "-ul"))
             user_page_limit = atoi(value);
@@ -270,6 +288,8 @@ parse_options(char **argv)
         else
             PANIC("unknown option `%s' (use -h for help)", name);
     }
+    if (thread_mlfqs && thread_fair)
+        PANIC("-mlfqs and -fair cannot be used together");
 
     /* Initialize the random number generator based on the system
      time.  This has no effect if an "-rs" option was specified.
@@ -385,6 +405,11 @@ usage(void)
 #endif
            "  -rs=SEED           Set random number seed to SEED.\n"
            "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+           "  -fair              Use fair-share scheduler, weighted by nice.\n"
+           "  -tickless          Stop the timer tick while idle.\n"
+           "  -no-prezero        Do not zero free pages while idle.\n"
+           "  -lend-min=COUNT    Keep COUNT free pages in a pool when lending.\n"
+           "  -lend-max=COUNT    Lend at most COUNT pages from a pool.\n"
 #ifdef USERPROG
            "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
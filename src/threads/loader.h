@@ -12,6 +12,17 @@
    Must be aligned on a 4 MB boundary. */
 #define LOADER_PHYS_BASE 0xc0000000 /* 3 GB. */
 
+/* Maximum amount of physical memory, in kB, that the kernel
+   maps at LOADER_PHYS_BASE.  This leaves the top 128 MB of the
+   kernel's virtual address space free for mappings that are not
+   RAM. */
+#define LOADER_RAM_MAX_KB 0xe0000 /* 896 MB. */
+
+/* Amount of physical memory, in bytes, mapped by the page tables
+   that start.S sets up, which are used until paging_init() maps
+   all of memory. */
+#define LOADER_BOOT_MAP_SIZE 0x4000000 /* 64 MB. */
+
 /* Important loader physical addresses. */
 #define LOADER_SIG (LOADER_END - LOADER_SIG_LEN)          /* 0xaa55 BIOS signature. */
 #define LOADER_PARTS (LOADER_SIG - LOADER_PARTS_LEN)      /* Partition table. */
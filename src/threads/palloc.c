@@ -2,13 +2,14 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/loader.h"
-#include "threads/synch.h"
+#include "threads/interrupt.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -23,22 +24,113 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Until paging_init() runs, only the first LOADER_BOOT_MAP_SIZE
+   bytes of memory are mapped, so palloc_init() keeps both pools'
+   maps at the start of free memory and only frees the pages
+   below that boundary.  palloc_init_high() frees the rest once
+   all of memory is mapped.
+
+   Each pool is managed as a binary buddy system.  Free memory is
+   kept as blocks of 2**ORDER pages, each aligned (relative to
+   the pool's base) on a multiple of its own size, on one free
+   list per order.  A request for PAGE_CNT pages takes a block of
+   the smallest order that fits, splitting a larger block if
+   necessary, and gives back the pages past PAGE_CNT.  Freeing
+   pages merges each block with its "buddy", the other half of
+   the block of the next higher order, for as long as the buddy
+   is free as well.  Both take O(log n) time.
+
+   The free lists are threaded through the free pages
+   themselves.  ORDER_MAP records, for each page, the order of
+   the free block that begins there, or ORDER_NONE; this is how a
+   block finds out whether its buddy is free.  The pool's
+   USED_MAP still records which pages are allocated, so that
+   freeing pages that are not allocated can be caught.
+
+   The pools are protected by disabling interrupts, because the
+   scheduler frees the pages of dead threads with interrupts
+   off.
+
+   Each pool also keeps a stack of up to ZEROED_MAX pages that
+   have already been filled with zeros, so that single-page
+   PAL_ZERO requests do not have to clear the page themselves.
+   The idle thread refills the stacks by calling
+   palloc_prezero_page() when there is nothing else to do.  The
+   pages on the stack count as allocated; if a pool runs out of
+   free blocks, they are returned to it before giving up.
+
+   When a pool cannot satisfy a request even then, it borrows the
+   pages from the other pool, which lends them as long as it
+   keeps at least LEND_MIN pages free for itself and has no more
+   than LEND_MAX pages on loan.  Each lent page is marked
+   ORDER_LENT in the lender's ORDER_MAP and goes back to the
+   lender when it is freed, even if the loan is freed piecemeal.  This way, a workload that needs mostly
+   user pages, or mostly kernel pages, can use memory that would
+   otherwise sit idle in the other pool. */
+
+/* Maximum number of pre-zeroed pages kept in each pool. */
+#define ZEROED_MAX 64
+
+/* Number of block orders.  The largest block is 2**(ORDER_CNT -
+   1) pages, i.e. 2 GB. */
+#define ORDER_CNT 20
+
+/* ORDER_MAP value for a page that does not start a free block. */
+#define ORDER_NONE 0xff
+
+/* ORDER_MAP value for a page lent to the other pool. */
+#define ORDER_LENT 0xfe
 
 /* A memory pool. */
 struct pool
 {
-    struct lock lock;        /* Mutual exclusion. */
-    struct bitmap *used_map; /* Bitmap of free pages. */
-    uint8_t *base;           /* Base of pool. */
+    struct bitmap *used_map;           /* Bitmap of free pages. */
+    uint8_t *order_map;                /* Order of free block at each page. */
+    struct list free_lists[ORDER_CNT]; /* Free blocks of each order. */
+    size_t free_cnt;                   /* Number of free pages. */
+    uint8_t *base;                     /* Base of pool. */
+
+    void *zeroed[ZEROED_MAX];          /* Pre-zeroed pages. */
+    size_t zeroed_cnt;                 /* Number of pre-zeroed pages. */
+    long long zeroed_hits;             /* PAL_ZERO pages from ZEROED. */
+    long long zeroed_misses;           /* PAL_ZERO pages cleared inline. */
+
+    size_t lend_min;                   /* Free pages kept when lending. */
+    size_t lend_max;                   /* Maximum pages on loan. */
+    size_t lent_cnt;                   /* Pages on loan to the other pool. */
+    size_t lent_peak;                  /* Maximum of LENT_CNT. */
+
+    size_t high_idx;                   /* First page not mapped at boot. */
 };
 
+/* Pages each pool keeps free for itself before lending to the
+   other pool, and maximum number of pages each pool lends out.
+   SIZE_MAX selects the default.  Controlled by kernel
+   command-line options "-lend-min" and "-lend-max". */
+size_t palloc_lend_min = SIZE_MAX;
+size_t palloc_lend_max = SIZE_MAX;
+
+/* If false (kernel command-line option "-no-prezero"), the idle
+   thread does not pre-zero pages. */
+bool palloc_prezero = true;
+
 /* Two pools: one for kernel data, one for user pages. */
 static struct pool kernel_pool, user_pool;
 
-static void init_pool(struct pool *, void *base, size_t page_cnt,
-                      const char *name);
+static size_t map_pages(size_t page_cnt);
+static void init_pool(struct pool *, void *map, void *base,
+                      size_t page_cnt, const char *name);
+static void init_pool_high(struct pool *);
 static bool page_from_pool(const struct pool *, void *page);
+static size_t take_block(struct pool *, size_t page_cnt);
+static void free_range(struct pool *, size_t page_idx, size_t page_cnt);
+static void free_block(struct pool *, size_t page_idx, unsigned order);
+static unsigned page_cnt_order(size_t page_cnt);
+static void *take_zeroed(struct pool *);
+static void drain_zeroed(struct pool *);
+static size_t lend_block(struct pool *, size_t page_cnt);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
    pages are put into the user pool. */
@@ -49,15 +141,37 @@ void palloc_init(size_t user_page_limit)
     uint8_t *free_end = ptov(init_ram_pages * PGSIZE);
     size_t free_pages = (free_end - free_start) / PGSIZE;
     size_t user_pages = free_pages / 2;
-    size_t kernel_pages;
+    size_t kernel_pages, kernel_map, user_map;
     if (user_pages > user_page_limit)
         user_pages = user_page_limit;
     kernel_pages = free_pages - user_pages;
 
+    /* Both pools' maps go at the start of the kernel pool, which
+     is mapped at boot. */
+    kernel_map = map_pages(kernel_pages);
+    user_map = map_pages(user_pages);
+    if (kernel_map + user_map > kernel_pages)
+        PANIC("Not enough memory in kernel pool for bitmaps.");
+
     /* Give half of memory to kernel, half to user. */
-    init_pool(&kernel_pool, free_start, kernel_pages, "kernel pool");
-    init_pool(&user_pool, free_start + kernel_pages * PGSIZE,
-              user_pages, "user pool");
+    init_pool(&kernel_pool, free_start,
+              free_start + (kernel_map + user_map) * PGSIZE,
+              kernel_pages - kernel_map - user_map, "kernel pool");
+    init_pool(&user_pool, free_start + kernel_map * PGSIZE,
+              free_start + kernel_pages * PGSIZE, user_pages, "user pool");
+
+    /* An explicit limit on user memory also limits borrowing. */
+    if (user_page_limit != SIZE_MAX)
+        kernel_pool.lend_max = 0;
+}
+
+/* Frees the pages that were not mapped when palloc_init() ran.
+   Must be called once, after paging_init() has mapped all of
+   physical memory. */
+void palloc_init_high(void)
+{
+    init_pool_high(&kernel_pool);
+    init_pool_high(&user_pool);
 }
 
 /* Obtains and returns a group of PAGE_CNT contiguous free pages.
@@ -70,15 +184,39 @@ void *
 palloc_get_multiple(enum palloc_flags flags, size_t page_cnt)
 {
     struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+    enum intr_level old_level;
     void *pages;
     size_t page_idx;
 
     if (page_cnt == 0)
         return NULL;
 
-    lock_acquire(&pool->lock);
-    page_idx = bitmap_scan_and_flip(pool->used_map, 0, page_cnt, false);
-    lock_release(&pool->lock);
+    if ((flags & PAL_ZERO) && page_cnt == 1)
+    {
+        old_level = intr_disable();
+        pages = take_zeroed(pool);
+        intr_set_level(old_level);
+        if (pages != NULL)
+            return pages;
+    }
+
+    old_level = intr_disable();
+    page_idx = take_block(pool, page_cnt);
+    if (page_idx == BITMAP_ERROR && pool->zeroed_cnt > 0)
+    {
+        drain_zeroed(pool);
+        page_idx = take_block(pool, page_cnt);
+    }
+    if (page_idx == BITMAP_ERROR)
+    {
+        /* Borrow the pages from the other pool, if it can spare
+         them. */
+        struct pool *lender = pool == &user_pool ? &kernel_pool : &user_pool;
+        page_idx = lend_block(lender, page_cnt);
+        if (page_idx != BITMAP_ERROR)
+            pool = lender;
+    }
+    intr_set_level(old_level);
 
     if (page_idx != BITMAP_ERROR)
         pages = pool->base + PGSIZE * page_idx;
@@ -116,7 +254,8 @@ palloc_get_page(enum palloc_flags flags)
 void palloc_free_multiple(void *pages, size_t page_cnt)
 {
     struct pool *pool;
-    size_t page_idx;
+    enum intr_level old_level;
+    size_t page_idx, i;
 
     ASSERT(pg_ofs(pages) == 0);
     if (pages == NULL || page_cnt == 0)
@@ -135,8 +274,17 @@ void palloc_free_multiple(void *pages, size_t page_cnt)
     memset(pages, 0xcc, PGSIZE * page_cnt);
 #endif
 
+    old_level = intr_disable();
     ASSERT(bitmap_all(pool->used_map, page_idx, page_cnt));
+    for (i = 0; i < page_cnt; i++)
+        if (pool->order_map[page_idx + i] == ORDER_LENT)
+        {
+            pool->order_map[page_idx + i] = ORDER_NONE;
+            pool->lent_cnt--;
+        }
     bitmap_set_multiple(pool->used_map, page_idx, page_cnt, false);
+    free_range(pool, page_idx, page_cnt);
+    intr_set_level(old_level);
 }
 
 /* Frees the page at PAGE. */
@@ -145,25 +293,133 @@ void palloc_free_page(void *page)
     palloc_free_multiple(page, 1);
 }
 
-/* Initializes pool P as starting at START and ending at END,
-   naming it NAME for debugging purposes. */
+/* Takes a free page from a pool that is short of pre-zeroed
+   pages, zeroes it, and keeps it for a later PAL_ZERO request.
+   Returns true if it did so, false if every pool has enough
+   pre-zeroed pages or too few free pages to spare.  Meant to be
+   called by the idle thread, with interrupts on. */
+bool palloc_prezero_page(void)
+{
+    struct pool *pools[] = {&user_pool, &kernel_pool};
+    size_t i;
+
+    if (!palloc_prezero)
+        return false;
+
+    for (i = 0; i < sizeof pools / sizeof *pools; i++)
+    {
+        struct pool *p = pools[i];
+        enum intr_level old_level;
+        size_t page_idx = BITMAP_ERROR;
+        void *page;
+
+        old_level = intr_disable();
+        if (p->zeroed_cnt < ZEROED_MAX && p->free_cnt > ZEROED_MAX)
+            page_idx = take_block(p, 1);
+        intr_set_level(old_level);
+        if (page_idx == BITMAP_ERROR)
+            continue;
+
+        page = p->base + PGSIZE * page_idx;
+        memset(page, 0, PGSIZE);
+
+        old_level = intr_disable();
+        if (p->zeroed_cnt < ZEROED_MAX)
+            p->zeroed[p->zeroed_cnt++] = page;
+        else
+        {
+            bitmap_reset(p->used_map, page_idx);
+            free_range(p, page_idx, 1);
+        }
+        intr_set_level(old_level);
+        return true;
+    }
+    return false;
+}
+
+/* Prints page allocator statistics: for each pool, the number
+   of free pages and the size of the largest free block. */
+void palloc_print_stats(void)
+{
+    struct pool *pools[] = {&kernel_pool, &user_pool};
+    const char *names[] = {"kernel", "user"};
+    size_t i;
+
+    for (i = 0; i < sizeof pools / sizeof *pools; i++)
+    {
+        struct pool *p = pools[i];
+        int order;
+
+        for (order = ORDER_CNT - 1; order >= 0; order--)
+            if (!list_empty(&p->free_lists[order]))
+                break;
+        printf("Palloc: %s pool %zu of %zu pages free, "
+               "largest free block %zu pages\n",
+               names[i], p->free_cnt, bitmap_size(p->used_map),
+               order >= 0 ? (size_t)1 << order : 0);
+        printf("Palloc: %s pool %lld of %lld PAL_ZERO pages served pre-zeroed\n",
+               names[i], p->zeroed_hits, p->zeroed_hits + p->zeroed_misses);
+        printf("Palloc: %s pool %zu pages on loan, peak %zu\n",
+               names[i], p->lent_cnt, p->lent_peak);
+    }
+}
+
+/* Returns the number of pages needed for the used_map and
+   order_map of a pool of PAGE_CNT pages. */
+static size_t
+map_pages(size_t page_cnt)
+{
+    return DIV_ROUND_UP(bitmap_buf_size(page_cnt) + page_cnt, PGSIZE);
+}
+
+/* Initializes pool P as holding the PAGE_CNT pages starting at
+   BASE, with its maps at MAP, naming it NAME for debugging
+   purposes.  Only the pages that are mapped at boot are freed. */
 static void
-init_pool(struct pool *p, void *base, size_t page_cnt, const char *name)
+init_pool(struct pool *p, void *map, void *base, size_t page_cnt,
+          const char *name)
 {
-    /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
-     and subtract it from the pool's size. */
-    size_t bm_pages = DIV_ROUND_UP(bitmap_buf_size(page_cnt), PGSIZE);
-    if (bm_pages > page_cnt)
-        PANIC("Not enough memory in %s for bitmap.", name);
-    page_cnt -= bm_pages;
+    size_t map_bytes = bitmap_buf_size(page_cnt);
+    size_t boot_pages = pg_no(ptov(LOADER_BOOT_MAP_SIZE));
+    size_t i;
 
     printf("%zu pages available in %s.\n", page_cnt, name);
 
     /* Initialize the pool. */
-    lock_init(&p->lock);
-    p->used_map = bitmap_create_in_buf(page_cnt, base, bm_pages * PGSIZE);
-    p->base = base + bm_pages * PGSIZE;
+    p->used_map = bitmap_create_in_buf(page_cnt, map, map_bytes);
+    p->order_map = (uint8_t *)map + map_bytes;
+    memset(p->order_map, ORDER_NONE, page_cnt);
+    for (i = 0; i < ORDER_CNT; i++)
+        list_init(&p->free_lists[i]);
+    p->free_cnt = 0;
+    p->zeroed_cnt = 0;
+    p->zeroed_hits = p->zeroed_misses = 0;
+    p->lend_min = palloc_lend_min != SIZE_MAX ? palloc_lend_min : page_cnt / 8;
+    p->lend_max = palloc_lend_max != SIZE_MAX ? palloc_lend_max : page_cnt;
+    p->lent_cnt = p->lent_peak = 0;
+    p->base = base;
+
+    /* Free the pages below the end of the boot-time mapping, and
+     mark the rest as allocated until palloc_init_high(). */
+    p->high_idx = page_cnt;
+    if (pg_no(base) + page_cnt > boot_pages)
+        p->high_idx = pg_no(base) < boot_pages ? boot_pages - pg_no(base) : 0;
+    bitmap_set_multiple(p->used_map, p->high_idx, page_cnt - p->high_idx, true);
+    free_range(p, 0, p->high_idx);
+}
+
+/* Frees the pages of pool P that init_pool() left allocated. */
+static void
+init_pool_high(struct pool *p)
+{
+    size_t page_cnt = bitmap_size(p->used_map);
+    enum intr_level old_level;
+
+    old_level = intr_disable();
+    bitmap_set_multiple(p->used_map, p->high_idx, page_cnt - p->high_idx, false);
+    free_range(p, p->high_idx, page_cnt - p->high_idx);
+    p->high_idx = page_cnt;
+    intr_set_level(old_level);
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -177,3 +433,172 @@ page_from_pool(const struct pool *pool, void *page)
 
     return page_no >= start_page && page_no < end_page;
 }
+
+/* Returns the free list element stored in page PAGE_IDX of
+   POOL. */
+static struct list_elem *
+page_elem(struct pool *pool, size_t page_idx)
+{
+    return (struct list_elem *)(pool->base + PGSIZE * page_idx);
+}
+
+/* Returns the index of the page whose free list element is E. */
+static size_t
+elem_page(struct pool *pool, struct list_elem *e)
+{
+    return ((uint8_t *)e - pool->base) / PGSIZE;
+}
+
+/* Allocates PAGE_CNT contiguous pages from POOL and returns the
+   index of the first, or BITMAP_ERROR if no free block is large
+   enough.  Interrupts must be off. */
+static size_t
+take_block(struct pool *pool, size_t page_cnt)
+{
+    unsigned want = page_cnt_order(page_cnt);
+    unsigned order;
+    size_t page_idx;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    /* Find the smallest free block that is large enough. */
+    for (order = want; order < ORDER_CNT; order++)
+        if (!list_empty(&pool->free_lists[order]))
+            break;
+    if (order >= ORDER_CNT)
+        return BITMAP_ERROR;
+
+    page_idx = elem_page(pool, list_pop_front(&pool->free_lists[order]));
+    pool->order_map[page_idx] = ORDER_NONE;
+    pool->free_cnt -= (size_t)1 << order;
+
+    /* Split it, freeing the upper half each time, until it is
+     the requested order. */
+    while (order > want)
+    {
+        order--;
+        free_block(pool, page_idx + ((size_t)1 << order), order);
+    }
+
+    /* Give back the pages past PAGE_CNT. */
+    free_range(pool, page_idx + page_cnt, ((size_t)1 << want) - page_cnt);
+
+    ASSERT(!bitmap_any(pool->used_map, page_idx, page_cnt));
+    bitmap_set_multiple(pool->used_map, page_idx, page_cnt, true);
+    return page_idx;
+}
+
+/* Frees the PAGE_CNT pages starting at PAGE_IDX in POOL, as the
+   largest aligned blocks that they can be divided into.
+   Interrupts must be off, or the pool not yet in use. */
+static void
+free_range(struct pool *pool, size_t page_idx, size_t page_cnt)
+{
+    while (page_cnt > 0)
+    {
+        unsigned order = 0;
+
+        while (order + 1 < ORDER_CNT
+               && (page_idx & ((size_t)1 << order)) == 0
+               && ((size_t)2 << order) <= page_cnt)
+            order++;
+        free_block(pool, page_idx, order);
+        page_idx += (size_t)1 << order;
+        page_cnt -= (size_t)1 << order;
+    }
+}
+
+/* Frees the block of 2**ORDER pages starting at PAGE_IDX in
+   POOL, merging it with its buddy for as long as the buddy is
+   free too. */
+static void
+free_block(struct pool *pool, size_t page_idx, unsigned order)
+{
+    size_t page_cnt = bitmap_size(pool->used_map);
+
+    pool->free_cnt += (size_t)1 << order;
+    while (order + 1 < ORDER_CNT)
+    {
+        size_t buddy = page_idx ^ ((size_t)1 << order);
+
+        if (buddy >= page_cnt || pool->order_map[buddy] != order)
+            break;
+        list_remove(page_elem(pool, buddy));
+        pool->order_map[buddy] = ORDER_NONE;
+        if (buddy < page_idx)
+            page_idx = buddy;
+        order++;
+    }
+
+    pool->order_map[page_idx] = order;
+    list_push_front(&pool->free_lists[order], page_elem(pool, page_idx));
+}
+
+/* Returns a pre-zeroed page from POOL, or a null pointer if it
+   has none.  Interrupts must be off. */
+static void *
+take_zeroed(struct pool *pool)
+{
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (pool->zeroed_cnt == 0)
+    {
+        pool->zeroed_misses++;
+        return NULL;
+    }
+    pool->zeroed_hits++;
+    return pool->zeroed[--pool->zeroed_cnt];
+}
+
+/* Returns all of POOL's pre-zeroed pages to its free lists.
+   Interrupts must be off. */
+static void
+drain_zeroed(struct pool *pool)
+{
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    while (pool->zeroed_cnt > 0)
+    {
+        size_t page_idx = pg_no(pool->zeroed[--pool->zeroed_cnt]) - pg_no(pool->base);
+        bitmap_reset(pool->used_map, page_idx);
+        free_range(pool, page_idx, 1);
+    }
+}
+
+/* Allocates PAGE_CNT contiguous pages from POOL on behalf of
+   the other pool and returns the index of the first, or
+   BITMAP_ERROR if POOL cannot spare them.  Interrupts must be
+   off. */
+static size_t
+lend_block(struct pool *pool, size_t page_cnt)
+{
+    size_t page_idx;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (pool->free_cnt < page_cnt + pool->lend_min
+        || pool->lent_cnt + page_cnt > pool->lend_max)
+        return BITMAP_ERROR;
+
+    page_idx = take_block(pool, page_cnt);
+    if (page_idx != BITMAP_ERROR)
+    {
+        memset(pool->order_map + page_idx, ORDER_LENT, page_cnt);
+        pool->lent_cnt += page_cnt;
+        if (pool->lent_cnt > pool->lent_peak)
+            pool->lent_peak = pool->lent_cnt;
+    }
+    return page_idx;
+}
+
+/* Returns the smallest order whose blocks hold PAGE_CNT pages,
+   or ORDER_CNT if none does. */
+static unsigned
+page_cnt_order(size_t page_cnt)
+{
+    unsigned order = 0;
+
+    while (order < ORDER_CNT && ((size_t)1 << order) < page_cnt)
+        order++;
+    return order;
+}
@@ -1,6 +1,7 @@
 #ifndef THREADS_PALLOC_H
 #define THREADS_PALLOC_H
 
+#include <stdbool.h>
 #include <stddef.h>
 
 /* How to allocate pages. */
@@ -11,10 +12,23 @@ enum palloc_flags
     PAL_USER = 004    /* User page. */
 };
 
+/* If false, the idle thread does not pre-zero free pages.
+   Controlled by kernel command-line option "-no-prezero". */
+extern bool palloc_prezero;
+
+/* Pages each pool keeps free before lending to the other pool,
+   and maximum pages each pool lends out; SIZE_MAX selects the
+   default.  Controlled by "-lend-min" and "-lend-max". */
+extern size_t palloc_lend_min;
+extern size_t palloc_lend_max;
+
 void palloc_init(size_t user_page_limit);
+void palloc_init_high(void);
 void *palloc_get_page(enum palloc_flags);
 void *palloc_get_multiple(enum palloc_flags, size_t page_cnt);
 void palloc_free_page(void *);
 void palloc_free_multiple(void *, size_t page_cnt);
+bool palloc_prezero_page(void);
+void palloc_print_stats(void);
 
 #endif /* threads/palloc.h */
@@ -0,0 +1,305 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Slab allocator.
+
+   A slab cache hands out objects of one size.  It gets memory a
+   page at a time from the page allocator; each such page, called
+   a "slab", starts with a struct slab header, followed by a stack
+   of the indexes of its free objects, followed by the objects
+   themselves.  Because the free objects are tracked outside of
+   the objects, an object keeps whatever state its constructor
+   gave it, or its last user left in it, while it is free.
+
+   A cache keeps its slabs on three lists: partial, full, and
+   empty.  Allocation takes an object from a partial slab if
+   there is one, so that objects are packed into as few slabs as
+   possible.  Only one empty slab is kept, to absorb alternating
+   allocations and frees; further empty slabs are returned to the
+   page allocator.
+
+   The slab lists are protected by a lock.  To keep that lock
+   off the common path, each cache also has a small magazine of
+   recently freed objects, protected only by disabling
+   interrupts: slab_free() puts an object into the magazine while
+   it has room, and slab_alloc() takes one out when it can. */
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* Slab header, at the start of each slab's page. */
+struct slab
+{
+    unsigned magic;           /* Always set to SLAB_MAGIC. */
+    struct slab_cache *cache; /* Owning cache. */
+    struct list_elem elem;    /* Element in one of the cache's lists. */
+    size_t free_cnt;          /* Number of free objects. */
+    uint16_t free[];          /* Indexes of free objects, FREE_CNT valid. */
+};
+
+/* All caches. */
+static struct list all_caches = LIST_INITIALIZER(all_caches);
+
+static void *slab_take(struct slab_cache *);
+static void slab_put(struct slab_cache *, void *);
+static struct slab *slab_create(struct slab_cache *);
+static struct slab *obj_to_slab(const void *);
+
+/* Initializes cache C for objects of SIZE bytes, each aligned on
+   an ALIGN-byte boundary, or a pointer-size boundary if ALIGN is
+   0.  If CTOR is nonnull, it is called on each object when the
+   slab that holds it is created, and a freed object must be left
+   in its constructed state. */
+void slab_cache_init(struct slab_cache *c, const char *name,
+                     size_t size, size_t align, slab_ctor_func *ctor)
+{
+    enum intr_level old_level;
+
+    if (align == 0)
+        align = sizeof(void *);
+    ASSERT(c != NULL);
+    ASSERT(size > 0);
+    ASSERT(align < PGSIZE && (align & (align - 1)) == 0);
+
+    c->name = name;
+    c->size = size;
+    c->obj_size = ROUND_UP(size, align);
+    c->obj_cnt = (PGSIZE - sizeof(struct slab)) / (c->obj_size + sizeof(uint16_t));
+    for (;;)
+    {
+        c->obj_ofs = ROUND_UP(sizeof(struct slab) + c->obj_cnt * sizeof(uint16_t), align);
+        if (c->obj_ofs + c->obj_cnt * c->obj_size <= PGSIZE)
+            break;
+        c->obj_cnt--;
+    }
+    ASSERT(c->obj_cnt > 0 && c->obj_cnt <= UINT16_MAX);
+    c->ctor = ctor;
+
+    lock_init(&c->lock);
+    list_init(&c->partial);
+    list_init(&c->full);
+    list_init(&c->empty);
+    c->magazine_cnt = 0;
+    c->slab_cnt = 0;
+    c->in_use = 0;
+    c->max_in_use = 0;
+    c->alloc_cnt = 0;
+    c->magazine_hits = 0;
+
+    old_level = intr_disable();
+    list_push_back(&all_caches, &c->elem);
+    intr_set_level(old_level);
+}
+
+/* Obtains and returns an object from cache C.  Returns a null
+   pointer if memory is not available. */
+void *
+slab_alloc(struct slab_cache *c)
+{
+    enum intr_level old_level;
+    void *obj;
+
+    old_level = intr_disable();
+    c->alloc_cnt++;
+    if (++c->in_use > c->max_in_use)
+        c->max_in_use = c->in_use;
+    if (c->magazine_cnt > 0)
+    {
+        c->magazine_hits++;
+        obj = c->magazine[--c->magazine_cnt];
+        intr_set_level(old_level);
+        return obj;
+    }
+    intr_set_level(old_level);
+
+    lock_acquire(&c->lock);
+    obj = slab_take(c);
+    lock_release(&c->lock);
+
+    if (obj == NULL)
+    {
+        old_level = intr_disable();
+        c->in_use--;
+        intr_set_level(old_level);
+    }
+    return obj;
+}
+
+/* Returns OBJ, which must have been obtained from cache C with
+   slab_alloc(), to C.  Does nothing if OBJ is a null pointer. */
+void slab_free(struct slab_cache *c, void *obj)
+{
+    enum intr_level old_level;
+
+    if (obj == NULL)
+        return;
+    ASSERT(obj_to_slab(obj)->cache == c);
+
+    old_level = intr_disable();
+    c->in_use--;
+    if (c->magazine_cnt < SLAB_MAGAZINE_SIZE)
+    {
+        c->magazine[c->magazine_cnt++] = obj;
+        intr_set_level(old_level);
+        return;
+    }
+    intr_set_level(old_level);
+
+    lock_acquire(&c->lock);
+    slab_put(c, obj);
+    lock_release(&c->lock);
+}
+
+/* Returns the cache that OBJ, which must be in a slab, belongs
+   to. */
+struct slab_cache *
+slab_cache_of(const void *obj)
+{
+    return obj_to_slab(obj)->cache;
+}
+
+/* Returns true if OBJ is in the page of some slab. */
+bool slab_owns(const void *obj)
+{
+    const struct slab *s = pg_round_down(obj);
+    return s->magic == SLAB_MAGIC;
+}
+
+/* Prints statistics for each cache that has been used, including
+   the memory saved compared with rounding each object up to a
+   power of 2, as malloc() used to. */
+void slab_print_stats(void)
+{
+    struct list_elem *e;
+
+    for (e = list_begin(&all_caches); e != list_end(&all_caches);
+         e = list_next(e))
+    {
+        struct slab_cache *c = list_entry(e, struct slab_cache, elem);
+        size_t pow2 = 16;
+
+        if (c->alloc_cnt == 0)
+            continue;
+        while (pow2 < c->size)
+            pow2 *= 2;
+        printf("Slab %s: %zu in use (peak %zu) in %zu slabs, "
+               "%lld allocs (%lld from magazine), %zu bytes saved at peak\n",
+               c->name, c->in_use, c->max_in_use, c->slab_cnt,
+               c->alloc_cnt, c->magazine_hits,
+               pow2 > c->obj_size ? c->max_in_use * (pow2 - c->obj_size) : 0);
+    }
+}
+
+/* Takes a free object from one of C's slabs, creating a new slab
+   if necessary.  Returns a null pointer if memory is not
+   available.  C's lock must be held. */
+static void *
+slab_take(struct slab_cache *c)
+{
+    struct slab *s;
+
+    ASSERT(lock_held_by_current_thread(&c->lock));
+
+    if (!list_empty(&c->partial))
+        s = list_entry(list_front(&c->partial), struct slab, elem);
+    else if (!list_empty(&c->empty))
+    {
+        s = list_entry(list_pop_front(&c->empty), struct slab, elem);
+        list_push_front(&c->partial, &s->elem);
+    }
+    else
+    {
+        s = slab_create(c);
+        if (s == NULL)
+            return NULL;
+        list_push_front(&c->partial, &s->elem);
+    }
+
+    if (--s->free_cnt == 0)
+    {
+        list_remove(&s->elem);
+        list_push_front(&c->full, &s->elem);
+    }
+    return (uint8_t *)s + c->obj_ofs + s->free[s->free_cnt] * c->obj_size;
+}
+
+/* Returns OBJ to its slab in cache C, and frees the slab if that
+   makes it a second empty one.  C's lock must be held. */
+static void
+slab_put(struct slab_cache *c, void *obj)
+{
+    struct slab *s = obj_to_slab(obj);
+    size_t ofs = (uint8_t *)obj - (uint8_t *)s - c->obj_ofs;
+
+    ASSERT(lock_held_by_current_thread(&c->lock));
+    ASSERT(ofs % c->obj_size == 0);
+    ASSERT(s->free_cnt < c->obj_cnt);
+
+    s->free[s->free_cnt++] = ofs / c->obj_size;
+    if (s->free_cnt == 1 || s->free_cnt == c->obj_cnt)
+        list_remove(&s->elem);
+    if (s->free_cnt < c->obj_cnt)
+    {
+        if (s->free_cnt == 1)
+            list_push_front(&c->partial, &s->elem);
+    }
+    else if (list_empty(&c->empty))
+        list_push_front(&c->empty, &s->elem);
+    else
+    {
+        enum intr_level old_level;
+
+        s->magic = 0;
+        palloc_free_page(s);
+        old_level = intr_disable();
+        c->slab_cnt--;
+        intr_set_level(old_level);
+    }
+}
+
+/* Creates and returns a new slab for cache C, with all of its
+   objects free and constructed, or returns a null pointer if
+   memory is not available. */
+static struct slab *
+slab_create(struct slab_cache *c)
+{
+    enum intr_level old_level;
+    struct slab *s;
+    size_t i;
+
+    s = palloc_get_page(0);
+    if (s == NULL)
+        return NULL;
+
+    s->magic = SLAB_MAGIC;
+    s->cache = c;
+    s->free_cnt = c->obj_cnt;
+    for (i = 0; i < c->obj_cnt; i++)
+    {
+        s->free[i] = c->obj_cnt - 1 - i;
+        if (c->ctor != NULL)
+            c->ctor((uint8_t *)s + c->obj_ofs + i * c->obj_size);
+    }
+
+    old_level = intr_disable();
+    c->slab_cnt++;
+    intr_set_level(old_level);
+    return s;
+}
+
+/* Returns the slab that OBJ is inside. */
+static struct slab *
+obj_to_slab(const void *obj)
+{
+    struct slab *s = pg_round_down(obj);
+
+    ASSERT(s != NULL);
+    ASSERT(s->magic == SLAB_MAGIC);
+    return s;
+}
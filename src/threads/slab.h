@@ -0,0 +1,55 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <list.h>
+#include <stddef.h>
+#include "threads/synch.h"
+
+/* Initializes object OBJ of a slab cache, when the slab that
+   holds it is created. */
+typedef void slab_ctor_func(void *obj);
+
+/* Number of freed objects that a cache keeps for reuse without
+   taking its lock. */
+#define SLAB_MAGAZINE_SIZE 16
+
+/* An object cache: allocates objects of a single size out of
+   page-sized slabs. */
+struct slab_cache
+{
+    const char *name;         /* Name, for statistics. */
+    size_t size;              /* Object size requested. */
+    size_t obj_size;          /* Object size, rounded up for alignment. */
+    size_t obj_ofs;           /* Offset of the first object in a slab. */
+    size_t obj_cnt;           /* Number of objects in a slab. */
+    slab_ctor_func *ctor;     /* Object constructor, or null. */
+
+    struct lock lock;         /* Protects the slab lists. */
+    struct list partial;      /* Slabs with some objects free. */
+    struct list full;         /* Slabs with no object free. */
+    struct list empty;        /* Slabs with every object free. */
+
+    /* Magazine of freed objects, protected by disabling
+       interrupts instead of LOCK. */
+    void *magazine[SLAB_MAGAZINE_SIZE];
+    size_t magazine_cnt;
+
+    /* Statistics, protected by disabling interrupts. */
+    size_t slab_cnt;          /* Slabs allocated. */
+    size_t in_use;            /* Objects allocated. */
+    size_t max_in_use;        /* Maximum of IN_USE. */
+    long long alloc_cnt;      /* Calls to slab_alloc(). */
+    long long magazine_hits;  /* Allocations served from the magazine. */
+
+    struct list_elem elem;    /* Element in list of all caches. */
+};
+
+void slab_cache_init(struct slab_cache *, const char *name,
+                     size_t size, size_t align, slab_ctor_func *);
+void *slab_alloc(struct slab_cache *);
+void slab_free(struct slab_cache *, void *);
+struct slab_cache *slab_cache_of(const void *);
+bool slab_owns(const void *);
+void slab_print_stats(void);
+
+#endif /* threads/slab.h */
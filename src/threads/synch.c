@@ -32,7 +32,15 @@
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 
-static list_less_func less_sema_priority;
+static heap_less_func less_waiter;
+static void waiter_push(struct heap *, struct thread *);
+static struct thread *waiter_pop(struct heap *);
+static void donate_priority(struct lock *, int priority);
+static void lock_take(struct lock *);
+
+/* Arrival counter for waiters, used to wake waiters of equal
+   priority in FIFO order. */
+static unsigned next_wait_seq;
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -48,7 +56,7 @@ void sema_init(struct semaphore *sema, unsigned value)
     ASSERT(sema != NULL);
 
     sema->value = value;
-    list_init(&sema->waiters);
+    heap_init(&sema->waiters, less_waiter, NULL);
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -68,7 +76,7 @@ void sema_down(struct semaphore *sema)
     old_level = intr_disable();
     while (sema->value == 0)
     {
-        list_push_back(&sema->waiters, &thread_current()->elem);
+        waiter_push(&sema->waiters, thread_current());
         thread_block();
     }
     sema->value--;
@@ -113,14 +121,8 @@ void sema_up(struct semaphore *sema)
 
     old_level = intr_disable();
     sema->value++;
-    if (!list_empty(&sema->waiters))
-    {
-        struct list_elem *max_e = list_max(&sema->waiters, less_priority, NULL);
-        struct thread *max_t = list_entry(max_e, struct thread, elem);
-
-        list_remove(max_e);
-        thread_unblock(max_t);
-    }
+    if (!heap_empty(&sema->waiters))
+        thread_unblock(waiter_pop(&sema->waiters));
     intr_set_level(old_level);
 }
 
@@ -180,14 +182,15 @@ void lock_init(struct lock *lock)
     ASSERT(lock != NULL);
 
     lock->holder = NULL;
+    lock->max_priority = PRI_MIN - 1;
     sema_init(&lock->semaphore, 1);
 }
 
-/* If the holder of LOCK has lower priority than the current
-   thread, it, its donee, its donee's donee, and so on should
-   be donated priority. Then, acquire LOCK, sleeping until it
-   becomes available if necessary. The lock must not already
-   be held by the current thread.
+/* Acquires LOCK, sleeping until it becomes available if
+   necessary.  While the current thread waits, its priority is
+   donated to the holder of LOCK, and through it to the holder
+   of the lock that one is waiting for, and so on.  The lock
+   must not already be held by the current thread.
 
    This function may sleep, so it must not be called within an
    interrupt handler.  This function may be called with
@@ -195,26 +198,24 @@ void lock_init(struct lock *lock)
    we need to sleep. */
 void lock_acquire(struct lock *lock)
 {
+    enum intr_level old_level;
+
     ASSERT(lock != NULL);
     ASSERT(!intr_context());
     ASSERT(!lock_held_by_current_thread(lock));
 
-    struct thread *cur = thread_current();
-
-    if (!thread_mlfqs && lock->holder != NULL && lock->holder->priority < cur->priority)
+    old_level = intr_disable();
+    if (lock->holder != NULL)
     {
-        struct thread *donee = lock->holder;
-        while (donee != NULL)
-        {
-            donee->priority = cur->priority;
-            donee = donee->donee;
-        }
-        thread_set_donee(lock->holder);
-        list_push_back(&lock->holder->donators, &cur->doelem);
-    }
+        struct thread *cur = thread_current();
 
+        cur->waiting_lock = lock;
+        if (!thread_mlfqs)
+            donate_priority(lock, cur->priority);
+    }
     sema_down(&lock->semaphore);
-    lock->holder = cur;
+    lock_take(lock);
+    intr_set_level(old_level);
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -225,53 +226,93 @@ void lock_acquire(struct lock *lock)
    interrupt handler. */
 bool lock_try_acquire(struct lock *lock)
 {
+    enum intr_level old_level;
     bool success;
 
     ASSERT(lock != NULL);
     ASSERT(!lock_held_by_current_thread(lock));
 
+    old_level = intr_disable();
     success = sema_try_down(&lock->semaphore);
     if (success)
-        lock->holder = thread_current();
+        lock_take(lock);
+    intr_set_level(old_level);
     return success;
 }
 
-/* Delete all donators of the current thread, which are waiting
-   for LOCK. Then, release LOCK, which must be owned by the
-   current thread. Lastly, delete its donee and set its priority
-   properly.
+/* Releases LOCK, which must be owned by the current thread, and
+   drops whatever priority was donated through it.
 
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to release a lock within an interrupt
    handler. */
 void lock_release(struct lock *lock)
 {
+    struct thread *cur = thread_current();
+    enum intr_level old_level;
+
     ASSERT(lock != NULL);
     ASSERT(lock_held_by_current_thread(lock));
 
-    struct list *waiters = &lock->semaphore.waiters,
-                *donators = thread_get_donators();
-    struct list_elem *e, *de;
-
-    if (!thread_mlfqs)
-        for (e = list_begin(waiters); e != list_end(waiters); e = list_next(e))
-            for (de = list_begin(donators); de != list_end(donators); de = list_next(de))
-                if (&list_entry(e, struct thread, elem)->doelem == de)
-                {
-                    list_remove(de);
-                    break;
-                }
-
+    old_level = intr_disable();
+    heap_remove(&cur->held_locks, &lock->elem);
     lock->holder = NULL;
     sema_up(&lock->semaphore);
-
     if (!thread_mlfqs)
+        thread_update_priority(cur);
+    intr_set_level(old_level);
+}
+
+/* Raises the maximum waiter priority of LOCK to PRIORITY, and
+   passes the donation on to its holder and along the chain of
+   locks that holder is waiting for.  Stops as soon as a lock or
+   holder already has at least PRIORITY, so each donation
+   touches each lock in the chain at most once.  Interrupts must
+   be off. */
+static void
+donate_priority(struct lock *lock, int priority)
+{
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    while (lock != NULL && lock->max_priority < priority)
     {
-        thread_set_donee(NULL);
-        thread_set_priority(thread_get_priority());
+        struct thread *holder = lock->holder;
+
+        lock->max_priority = priority;
+        if (holder == NULL)
+            break;
+
+        /* Keep the holder's held_locks in heap order. */
+        heap_update(&holder->held_locks, &lock->elem);
+        if (holder->priority >= priority)
+            break;
+        thread_change_priority(holder, priority);
+        lock = holder->waiting_lock;
     }
 }
 
+/* Makes the current thread the holder of LOCK, which it has just
+   downed.  Any threads still waiting on LOCK keep donating to the
+   new holder.  Interrupts must be off. */
+static void
+lock_take(struct lock *lock)
+{
+    struct thread *cur = thread_current();
+    struct heap *waiters = &lock->semaphore.waiters;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    lock->holder = cur;
+    cur->waiting_lock = NULL;
+    lock->max_priority = PRI_MIN - 1;
+    if (!heap_empty(waiters))
+        lock->max_priority = heap_entry(heap_top(waiters), struct thread,
+                                        waitelem)->priority;
+    heap_insert(&cur->held_locks, &lock->elem);
+    if (!thread_mlfqs && lock->max_priority > cur->priority)
+        thread_change_priority(cur, lock->max_priority);
+}
+
 /* Returns true if the current thread holds LOCK, false
    otherwise.  (Note that testing whether some other thread holds
    a lock would be racy.) */
@@ -282,14 +323,6 @@ bool lock_held_by_current_thread(const struct lock *lock)
     return lock->holder == thread_current();
 }
 
-/* One semaphore in a list. */
-struct semaphore_elem
-{
-    struct list_elem elem;      /* List element. */
-    struct semaphore semaphore; /* This semaphore. */
-    int priority;               /* Priority. */
-};
-
 /* Initializes condition variable COND.  A condition variable
    allows one piece of code to signal a condition and cooperating
    code to receive the signal and act upon it. */
@@ -297,7 +330,7 @@ void cond_init(struct condition *cond)
 {
     ASSERT(cond != NULL);
 
-    list_init(&cond->waiters);
+    heap_init(&cond->waiters, less_waiter, NULL);
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -322,67 +355,250 @@ void cond_init(struct condition *cond)
    we need to sleep. */
 void cond_wait(struct condition *cond, struct lock *lock)
 {
-    struct semaphore_elem waiter;
+    struct thread *cur = thread_current();
+    enum intr_level old_level;
 
     ASSERT(cond != NULL);
     ASSERT(lock != NULL);
     ASSERT(!intr_context());
     ASSERT(lock_held_by_current_thread(lock));
 
-    sema_init(&waiter.semaphore, 0);
-    waiter.priority = thread_get_priority();
-    list_push_back(&cond->waiters, &waiter.elem);
+    old_level = intr_disable();
+    waiter_push(&cond->waiters, cur);
     lock_release(lock);
-    sema_down(&waiter.semaphore);
+
+    /* lock_release() may have yielded to a thread that signaled
+       us already, in which case there is nothing to wait for.
+       Otherwise cond_signal() moves us onto LOCK's waiters, and
+       we are woken when LOCK is released to us. */
+    if (cur->wait_heap == &cond->waiters)
+    {
+        cur->waiting_cond = cond;
+        thread_block();
+        cur->waiting_cond = NULL;
+    }
+    intr_set_level(old_level);
+
     lock_acquire(lock);
 }
 
+/* Moves the highest-priority waiter on COND over to LOCK, which
+   the current thread holds, so that it is woken by the
+   lock_release() that makes LOCK available to it rather than
+   right away.  This is "wait morphing": a woken waiter would only
+   block again on LOCK immediately.  Interrupts must be off. */
+static void
+cond_wake_one(struct condition *cond, struct lock *lock)
+{
+    struct thread *t = waiter_pop(&cond->waiters);
+
+    /* A waiter that has not blocked yet is still on its way out
+       of lock_release() in cond_wait(), and will acquire LOCK
+       itself.  Its status does not tell: it may have been
+       preempted and parked there. */
+    if (t->waiting_cond != cond)
+        return;
+
+    waiter_push(&lock->semaphore.waiters, t);
+    t->waiting_lock = lock;
+    if (!thread_mlfqs)
+        donate_priority(lock, t->priority);
+}
+
 /* If any threads are waiting on COND (protected by LOCK), then
-   this function signals one of them to wake up from its wait.
-   LOCK must be held before calling this function.
+   this function signals the one with the highest priority to
+   wake up from its wait.  LOCK must be held before calling this
+   function.
 
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to signal a condition variable within an
    interrupt handler. */
-void cond_signal(struct condition *cond, struct lock *lock UNUSED)
+void cond_signal(struct condition *cond, struct lock *lock)
 {
+    enum intr_level old_level;
+
     ASSERT(cond != NULL);
     ASSERT(lock != NULL);
     ASSERT(!intr_context());
     ASSERT(lock_held_by_current_thread(lock));
 
-    if (!list_empty(&cond->waiters))
-    {
-        struct list_elem *e = list_max(&cond->waiters, less_sema_priority, NULL);
-        struct semaphore_elem *se = list_entry(e, struct semaphore_elem, elem);
-
-        list_remove(e);
-        sema_up(&se->semaphore);
-    }
+    old_level = intr_disable();
+    if (!heap_empty(&cond->waiters))
+        cond_wake_one(cond, lock);
+    intr_set_level(old_level);
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
-   LOCK).  LOCK must be held before calling this function.
+   LOCK).  LOCK must be held before calling this function.  The
+   waiters are queued on LOCK, so they run one at a time as it is
+   handed over instead of all contending for it at once.
 
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to signal a condition variable within an
    interrupt handler. */
 void cond_broadcast(struct condition *cond, struct lock *lock)
 {
+    enum intr_level old_level;
+
     ASSERT(cond != NULL);
     ASSERT(lock != NULL);
+    ASSERT(!intr_context());
+    ASSERT(lock_held_by_current_thread(lock));
+
+    old_level = intr_disable();
+    while (!heap_empty(&cond->waiters))
+        cond_wake_one(cond, lock);
+    intr_set_level(old_level);
+}
+
+/* Initializes RWLOCK.  A readers-writer lock may be held either
+   by any number of readers at once or by a single writer.
+
+   Writers are preferred: once a writer is waiting, arriving
+   readers queue up behind it instead of starving it.  Readers and
+   writers waiting on an active writer wait on its WRITE_LOCK, so
+   they donate their priority to it as they would to the holder
+   of an ordinary lock.  Like locks, readers-writer locks are not
+   recursive. */
+void rwlock_init(struct rwlock *rw)
+{
+    ASSERT(rw != NULL);
+
+    lock_init(&rw->write_lock);
+    rw->readers = 0;
+    rw->writers = 0;
+    sema_init(&rw->drained, 0);
+}
+
+/* Acquires RW for reading, sleeping until no writer holds or is
+   waiting for it.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void rwlock_acquire_read(struct rwlock *rw)
+{
+    enum intr_level old_level;
+
+    ASSERT(rw != NULL);
+    ASSERT(!intr_context());
+    ASSERT(!rwlock_held_by_current_thread(rw));
+
+    old_level = intr_disable();
+    while (rw->writers > 0)
+    {
+        /* Wait for the writer, donating to it meanwhile. */
+        lock_acquire(&rw->write_lock);
+        lock_release(&rw->write_lock);
+    }
+    rw->readers++;
+    intr_set_level(old_level);
+}
+
+/* Releases RW, which the current thread must hold for
+   reading. */
+void rwlock_release_read(struct rwlock *rw)
+{
+    enum intr_level old_level;
+
+    ASSERT(rw != NULL);
+
+    old_level = intr_disable();
+    ASSERT(rw->readers > 0);
+    if (--rw->readers == 0 && rw->writers > 0)
+        sema_up(&rw->drained);
+    intr_set_level(old_level);
+}
+
+/* Acquires RW for writing, sleeping until every other reader and
+   writer has released it.
 
-    while (!list_empty(&cond->waiters))
-        cond_signal(cond, lock);
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void rwlock_acquire_write(struct rwlock *rw)
+{
+    enum intr_level old_level;
+
+    ASSERT(rw != NULL);
+    ASSERT(!intr_context());
+
+    old_level = intr_disable();
+    rw->writers++;
+    lock_acquire(&rw->write_lock);
+    while (rw->readers > 0)
+        sema_down(&rw->drained);
+    intr_set_level(old_level);
+}
+
+/* Releases RW, which the current thread must hold for
+   writing. */
+void rwlock_release_write(struct rwlock *rw)
+{
+    enum intr_level old_level;
+
+    ASSERT(rw != NULL);
+    ASSERT(rwlock_held_by_current_thread(rw));
+
+    old_level = intr_disable();
+    rw->writers--;
+    lock_release(&rw->write_lock);
+    intr_set_level(old_level);
 }
 
-/* Compares priority of two list elements A and B.
-   Returns true if A is less than B, or false if A is
-   greater than or equal to B. */
+/* Returns true if the current thread holds RW for writing, false
+   otherwise.  There is no way to tell whether the current thread
+   is one of RW's readers. */
+bool rwlock_held_by_current_thread(const struct rwlock *rw)
+{
+    ASSERT(rw != NULL);
+
+    return lock_held_by_current_thread(&rw->write_lock);
+}
+
+/* Adds T to the waiters heap WAITERS.  Interrupts must be off. */
+static void
+waiter_push(struct heap *waiters, struct thread *t)
+{
+    t->wait_seq = next_wait_seq++;
+    t->wait_heap = waiters;
+    heap_insert(waiters, &t->waitelem);
+}
+
+/* Removes and returns the highest-priority thread in the waiters
+   heap WAITERS, which must not be empty.  Interrupts must be
+   off. */
+static struct thread *
+waiter_pop(struct heap *waiters)
+{
+    struct thread *t = heap_entry(heap_pop(waiters), struct thread, waitelem);
+
+    t->wait_heap = NULL;
+    return t;
+}
+
+/* Compares two waitelem heap elements A and B by priority, and
+   among threads of equal priority treats the one that started
+   waiting later as less, so that they are woken in FIFO order.
+   Returns true if A is less than B, or false if A is greater
+   than or equal to B. */
 static bool
-less_sema_priority(const struct list_elem *a, const struct list_elem *b, void *aux UNUSED)
+less_waiter(const struct heap_elem *a, const struct heap_elem *b, void *aux UNUSED)
+{
+    const struct thread *a_t = heap_entry(a, struct thread, waitelem);
+    const struct thread *b_t = heap_entry(b, struct thread, waitelem);
+
+    if (a_t->priority != b_t->priority)
+        return a_t->priority < b_t->priority;
+    return (int)(a_t->wait_seq - b_t->wait_seq) > 0;
+}
+
+/* Compares the maximum waiter priority of two heap elements A
+   and B, which are elem members of struct lock.  Returns true if
+   A is less than B, so that a thread's held_locks heap keeps the
+   lock with the highest donation on top. */
+bool lock_less_priority(const struct heap_elem *a, const struct heap_elem *b,
+                        void *aux UNUSED)
 {
-    const struct semaphore_elem *a_s = list_entry(a, struct semaphore_elem, elem);
-    const struct semaphore_elem *b_s = list_entry(b, struct semaphore_elem, elem);
-    return a_s->priority < b_s->priority;
+    const struct lock *a_l = heap_entry(a, struct lock, elem);
+    const struct lock *b_l = heap_entry(b, struct lock, elem);
+    return a_l->max_priority < b_l->max_priority;
 }
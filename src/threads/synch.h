@@ -1,6 +1,7 @@
 #ifndef THREADS_SYNCH_H
 #define THREADS_SYNCH_H
 
+#include <heap.h>
 #include <list.h>
 #include <stdbool.h>
 
@@ -8,7 +9,7 @@
 struct semaphore
 {
     unsigned value;      /* Current value. */
-    struct list waiters; /* List of waiting threads. */
+    struct heap waiters; /* Waiting threads, by priority. */
 };
 
 void sema_init(struct semaphore *, unsigned value);
@@ -22,9 +23,12 @@ struct lock
 {
     struct thread *holder;      /* Thread holding lock (for debugging). */
     struct semaphore semaphore; /* Binary semaphore controlling access. */
+    struct heap_elem elem;      /* Element in holder's held_locks heap. */
+    int max_priority;           /* Highest priority among waiters. */
 };
 
 void lock_init(struct lock *);
+heap_less_func lock_less_priority;
 void lock_acquire(struct lock *);
 bool lock_try_acquire(struct lock *);
 void lock_release(struct lock *);
@@ -33,7 +37,7 @@ bool lock_held_by_current_thread(const struct lock *);
 /* Condition variable. */
 struct condition
 {
-    struct list waiters; /* List of waiting threads. */
+    struct heap waiters; /* Waiting threads, by priority. */
 };
 
 void cond_init(struct condition *);
@@ -41,6 +45,22 @@ void cond_wait(struct condition *, struct lock *);
 void cond_signal(struct condition *, struct lock *);
 void cond_broadcast(struct condition *, struct lock *);
 
+/* Readers-writer lock. */
+struct rwlock
+{
+    struct lock write_lock;   /* Held by the writer. */
+    unsigned readers;         /* Number of readers holding the lock. */
+    unsigned writers;         /* Writers holding or waiting for the lock. */
+    struct semaphore drained; /* Upped when the last reader leaves. */
+};
+
+void rwlock_init(struct rwlock *);
+void rwlock_acquire_read(struct rwlock *);
+void rwlock_release_read(struct rwlock *);
+void rwlock_acquire_write(struct rwlock *);
+void rwlock_release_write(struct rwlock *);
+bool rwlock_held_by_current_thread(const struct rwlock *);
+
 /* Optimization barrier.
 
    The compiler will not reorder operations across an
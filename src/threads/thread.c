@@ -4,6 +4,7 @@
 #include <random.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/cpugroup.h"
 #include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
@@ -11,6 +12,7 @@
 #include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "threads/workqueue.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #endif
@@ -25,13 +27,37 @@
    of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
-
-/* List of slept processes in THREAD_BLOCKED state, that is,
-   processes that are slept by timer_sleep(). */
-static struct list sleep_list;
+/* Run queue of processes in THREAD_READY state, that is,
+   processes that are ready to run but not actually running.
+   There is one FIFO per priority level, and bit P of
+   ready_bitmap is set if and only if ready_queues[P] is not
+   empty, so that the highest-priority ready thread can be found
+   without scanning. */
+#define PRI_CNT (PRI_MAX - PRI_MIN + 1)
+static struct list ready_queues[PRI_CNT];
+static uint64_t ready_bitmap;
+static size_t ready_cnt; /* # of threads in the run queue. */
+
+/* Run queue used instead of ready_queues[] by the fair-share
+   scheduler, ordered so that the thread with the least virtual
+   runtime is on top. */
+static struct heap fair_queue;
+
+/* Deadline class.  Threads in it are scheduled ahead of all
+   others, earliest deadline first.  Each may run for dl_runtime
+   ticks in every dl_period ticks; a thread that uses up its
+   budget, or that finishes its job with
+   thread_deadline_wait(), is parked in dl_throttled, ordered by
+   deadline, until the timer interrupt replenishes its budget
+   when its deadline arrives.  Admission control keeps the sum of
+   the admitted threads' runtime / period, in units of
+   1 / DL_BW_ONE, at or below DL_BW_MAX, so that every admitted
+   thread can meet its deadlines. */
+#define DL_BW_ONE 1024
+#define DL_BW_MAX (DL_BW_ONE * 95 / 100)
+static struct heap dl_queue;
+static struct list dl_throttled;
+static int dl_total_bw;
 
 /* List of all processes.  Processes are added to this list
    when they are first scheduled and removed when they exit. */
@@ -44,8 +70,14 @@ static struct thread *idle_thread;
 /* Initial thread, the thread running init.c:main(). */
 static struct thread *initial_thread;
 
-/* Lock used by allocate_tid(). */
-static struct lock tid_lock;
+/* Pages of threads that have exited, kept for reuse so that
+   creating a thread usually needs neither the page allocator's
+   lock nor a bitmap scan.  A page need not be cleared for reuse,
+   because init_thread() clears struct thread and nothing reads a
+   new thread's stack before writing it. */
+#define THREAD_PAGE_CACHE_MAX 16
+static void *thread_page_cache[THREAD_PAGE_CACHE_MAX];
+static size_t thread_page_cache_cnt;
 
 /* Stack frame for kernel_thread(). */
 struct kernel_thread_frame
@@ -55,8 +87,19 @@ struct kernel_thread_frame
     void *aux;             /* Auxiliary data for function. */
 };
 
+/* Initial stack of a new thread: the frames that switch_threads(),
+   switch_entry(), and kernel_thread() find on it, in that order,
+   the first time it is scheduled. */
+struct thread_start_frame
+{
+    struct switch_threads_frame sf;
+    struct switch_entry_frame ef;
+    struct kernel_thread_frame kf;
+};
+
 /* Statistics. */
 static long long idle_ticks;   /* # of timer ticks spent idle. */
+static long long idle_intrs;   /* # of timer interrupts while idle. */
 static long long kernel_ticks; /* # of timer ticks in kernel threads. */
 static long long user_ticks;   /* # of timer ticks in user programs. */
 
@@ -69,23 +112,92 @@ static unsigned thread_ticks; /* # of timer ticks since last yield. */
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* If true, use fair-share scheduler.
+   Controlled by kernel command-line option "-fair". */
+bool thread_fair;
+
+/* Fair-share scheduling.  Each thread's virtual runtime advances
+   by the nanoseconds of CPU time it uses, scaled down by its
+   weight relative to a thread with nice 0, and the thread with
+   the least virtual runtime runs next.  A running thread is
+   preempted once it gets FAIR_GRANULARITY_NS ahead of the least
+   virtual runtime in the run queue.  A thread that wakes up is
+   given at most FAIR_SLEEPER_CREDIT_NS of credit for the time it
+   slept, and preempts the running thread if it is at least
+   FAIR_WAKEUP_GRANULARITY_NS behind it. */
+#define NS_PER_TICK (1000000000 / TIMER_FREQ)
+#define FAIR_GRANULARITY_NS (TIME_SLICE * NS_PER_TICK)
+#define FAIR_SLEEPER_CREDIT_NS FAIR_GRANULARITY_NS
+#define FAIR_WAKEUP_GRANULARITY_NS NS_PER_TICK
+#define FAIR_WEIGHT_NICE_0 1024
+static int64_t min_vruntime;     /* Never decreases. */
+static int64_t fair_charged_ns;  /* Time of the last fair_charge(). */
+
+/* Weights for nice values NICE_MIN through NICE_MAX.  Each step
+   of nice changes the weight by about 25%, so that a thread gets
+   about 10% more or less of the CPU than a competitor whose nice
+   differs by one. */
+#define NICE_MIN -20
+#define NICE_MAX 20
+static const int fair_weights[NICE_MAX - NICE_MIN + 1] = {
+    88761, 71755, 56483, 46273, 36291, /* -20 ... -16 */
+    29154, 23254, 18705, 14949, 11916, /* -15 ... -11 */
+    9548, 7620, 6100, 4904, 3906,      /* -10 ...  -6 */
+    3121, 2501, 1991, 1586, 1277,      /*  -5 ...  -1 */
+    1024, 820, 655, 526, 423,          /*   0 ...   4 */
+    335, 272, 215, 172, 137,           /*   5 ...   9 */
+    110, 87, 70, 56, 45,               /*  10 ...  14 */
+    36, 29, 23, 18, 15,                /*  15 ...  19 */
+    12,                                /*  20 */
+};
+
 /* Average number of threads to run over the past time. */
 static int load_avg;
 
+/* recent_cpu of blocked threads is decayed lazily.  decay_epoch
+   counts the once-per-second decays so far, and
+   decay_coefficients[] remembers the coefficient of each of the
+   last DECAY_HISTORY of them, so that a thread can catch up on
+   the decays it slept through when it is next examined. */
+#define DECAY_HISTORY 64
+static int decay_epoch;
+static int decay_coefficients[DECAY_HISTORY];
+
+/* Worst-case time spent in thread_tick(), in cycles of the
+   time-stamp counter, which is much cheaper to read than the
+   8254's counter behind timer_ns(). */
+static uint64_t max_tick_cycles;
+
 static void kernel_thread(thread_func *, void *aux);
 
 static void idle(void *aux UNUSED);
 static struct thread *running_thread(void);
+static uint64_t rdtsc(void);
 static struct thread *next_thread_to_run(void);
 static void init_thread(struct thread *, const char *name, int priority);
 static bool is_thread(struct thread *) UNUSED;
 static void *alloc_frame(struct thread *, size_t size);
+static struct thread *thread_page_get(void);
+static void thread_page_put(struct thread *);
 static void schedule(void);
 void thread_schedule_tail(struct thread *prev);
 static tid_t allocate_tid(void);
 static thread_action_func update_priority;
 static thread_action_func update_recent_cpu;
 static void update_load_avg(void);
+static void decay_recent_cpu(void);
+static void ready_queue_push(struct thread *);
+static void ready_queue_remove(struct thread *);
+static int ready_queue_max_priority(void);
+static heap_less_func more_vruntime;
+static bool preempts(const struct thread *, const struct thread *);
+static heap_less_func later_deadline;
+static list_less_func earlier_deadline;
+static bool deadline_park(struct thread *);
+static void deadline_replenish(struct thread *, int64_t now);
+static int deadline_bw(int64_t runtime, int64_t period);
+static void fair_charge(struct thread *);
+static int fair_weight(int nice);
 
 /* Initializes the threading system by transforming the code
    that's currently running into a thread.  This can't work in
@@ -102,10 +214,15 @@ static void update_load_avg(void);
    finishes. */
 void thread_init(void)
 {
+    int i;
+
     ASSERT(intr_get_level() == INTR_OFF);
 
-    lock_init(&tid_lock);
-    list_init(&ready_list);
+    for (i = 0; i < PRI_CNT; i++)
+        list_init(&ready_queues[i]);
+    heap_init(&fair_queue, more_vruntime, NULL);
+    heap_init(&dl_queue, later_deadline, NULL);
+    list_init(&dl_throttled);
     list_init(&all_list);
     if (thread_mlfqs)
         load_avg = int_to_fixed(0);
@@ -138,10 +255,14 @@ void thread_start(void)
 void thread_tick(void)
 {
     struct thread *t = thread_current();
+    uint64_t start = rdtsc(), elapsed;
 
     /* Update statistics. */
     if (t == idle_thread)
+    {
         idle_ticks++;
+        idle_intrs++;
+    }
 #ifdef USERPROG
     else if (t->pagedir != NULL)
         user_ticks++;
@@ -157,25 +278,76 @@ void thread_tick(void)
         if (ticks % TIMER_FREQ == 0)
         {
             update_load_avg();
-            thread_foreach(update_recent_cpu, NULL);
+            decay_recent_cpu();
         }
+
+        /* Only the running thread's recent_cpu changes between
+         decays, so it is the only priority to recompute. */
         if (ticks % TIME_SLICE == 0)
         {
-            thread_foreach(update_priority, NULL);
-
-            if (!list_empty(&ready_list))
-            {
-                struct list_elem *max_e = list_max(&ready_list, less_priority, NULL);
+            update_priority(t, NULL);
 
-                if (t->priority < list_entry(max_e, struct thread, elem)->priority)
-                    intr_yield_on_return();
-            }
+            if (t->priority < ready_queue_max_priority())
+                intr_yield_on_return();
         }
     }
 
     /* Enforce preemption. */
-    if (++thread_ticks >= TIME_SLICE)
+    if (cpu_group_charge(t, timer_ticks()))
         intr_yield_on_return();
+    if (t->dl_period != 0)
+    {
+        /* A job that uses up its budget waits for the next one.
+           One that holds locks is not parked, so keep preempting
+           it until it releases them. */
+        if (--t->dl_budget <= 0)
+        {
+            t->dl_throttled = true;
+            intr_yield_on_return();
+        }
+    }
+    else if (thread_fair)
+    {
+        if (t != idle_thread)
+        {
+            fair_charge(t);
+            if (!heap_empty(&fair_queue)
+                && t->vruntime - heap_entry(heap_top(&fair_queue), struct thread, readyelem)->vruntime >= FAIR_GRANULARITY_NS)
+                intr_yield_on_return();
+        }
+    }
+    else if (++thread_ticks >= TIME_SLICE)
+        intr_yield_on_return();
+
+    elapsed = rdtsc() - start;
+    if (elapsed > max_tick_cycles)
+        max_tick_cycles = elapsed;
+}
+
+/* Called by devices/timer.c for each timer tick that passed
+   without a timer interrupt of its own, which only happens while
+   the idle thread runs in tickless mode.  Does the part of
+   thread_tick() that matters for the idle thread. */
+void thread_idle_tick(void)
+{
+    ASSERT(intr_get_level() == INTR_OFF);
+    ASSERT(running_thread() == idle_thread);
+
+    idle_ticks++;
+    if (thread_mlfqs && timer_ticks() % TIMER_FREQ == 0)
+    {
+        update_load_avg();
+        decay_recent_cpu();
+    }
+}
+
+/* Called by devices/timer.c for a timer interrupt that only
+   chains one one-shot interval to the next while the CPU is
+   idle, so that it is counted with the others. */
+void thread_idle_intr(void)
+{
+    if (running_thread() == idle_thread)
+        idle_intrs++;
 }
 
 /* Prints thread statistics. */
@@ -183,6 +355,12 @@ void thread_print_stats(void)
 {
     printf("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
            idle_ticks, kernel_ticks, user_ticks);
+    printf("Thread: %lld timer interrupts while idle (%lld per idle second)\n",
+           idle_intrs, idle_ticks > 0 ? idle_intrs * TIMER_FREQ / idle_ticks : 0);
+    printf("Thread: %llu cycles worst-case time in thread_tick()\n",
+           max_tick_cycles);
+    workqueue_print_stats();
+    cpu_group_print_stats();
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -204,15 +382,13 @@ tid_t thread_create(const char *name, int priority,
                     thread_func *function, void *aux)
 {
     struct thread *t;
-    struct kernel_thread_frame *kf;
-    struct switch_entry_frame *ef;
-    struct switch_threads_frame *sf;
+    struct thread_start_frame *frame;
     tid_t tid;
 
     ASSERT(function != NULL);
 
     /* Allocate thread. */
-    t = palloc_get_page(PAL_ZERO);
+    t = thread_page_get();
     if (t == NULL)
         return TID_ERROR;
 
@@ -220,20 +396,14 @@ tid_t thread_create(const char *name, int priority,
     init_thread(t, name, priority);
     tid = t->tid = allocate_tid();
 
-    /* Stack frame for kernel_thread(). */
-    kf = alloc_frame(t, sizeof *kf);
-    kf->eip = NULL;
-    kf->function = function;
-    kf->aux = aux;
-
-    /* Stack frame for switch_entry(). */
-    ef = alloc_frame(t, sizeof *ef);
-    ef->eip = (void (*)(void))kernel_thread;
-
-    /* Stack frame for switch_threads(). */
-    sf = alloc_frame(t, sizeof *sf);
-    sf->eip = switch_entry;
-    sf->ebp = 0;
+    /* Stack frames for switch_threads(), switch_entry(), and
+     kernel_thread(). */
+    frame = alloc_frame(t, sizeof *frame);
+    memset(frame, 0, sizeof *frame);
+    frame->sf.eip = switch_entry;
+    frame->ef.eip = (void (*)(void))kernel_thread;
+    frame->kf.function = function;
+    frame->kf.aux = aux;
 
     /* Add to run queue. */
     thread_unblock(t);
@@ -252,6 +422,8 @@ void thread_block(void)
     ASSERT(!intr_context());
     ASSERT(intr_get_level() == INTR_OFF);
 
+    if (thread_fair)
+        fair_charge(thread_current());
     thread_current()->status = THREAD_BLOCKED;
     schedule();
 }
@@ -261,6 +433,10 @@ void thread_block(void)
    make the running thread ready.) If the current thread has
    lower priority than T, it should yield.
 
+   If T's CPU group is throttled, T is parked on the group
+   instead, in the THREAD_PARKED state, until its next period
+   begins.
+
    This function does not preempt the running thread.  This can
    be important: if the caller had disabled interrupts itself,
    it may expect that it can atomically unblock a thread and
@@ -274,9 +450,29 @@ void thread_unblock(struct thread *t)
 
     old_level = intr_disable();
     ASSERT(t->status == THREAD_BLOCKED);
-    list_push_back(&ready_list, &t->elem);
+    if (cpu_group_park(t))
+    {
+        t->status = THREAD_PARKED;
+        intr_set_level(old_level);
+        return;
+    }
+    if (thread_mlfqs)
+        update_recent_cpu(t, NULL);
+    if (thread_fair && t->vruntime < min_vruntime - FAIR_SLEEPER_CREDIT_NS)
+        t->vruntime = min_vruntime - FAIR_SLEEPER_CREDIT_NS;
+    if (t->dl_period != 0)
+    {
+        /* Keep the budget and deadline of a thread that slept
+         only if finishing its job with them would not take more
+         than its share of the CPU. */
+        int64_t now = timer_ticks();
+        if (now >= t->dl_deadline
+            || t->dl_budget * t->dl_period > (t->dl_deadline - now) * t->dl_runtime)
+            deadline_replenish(t, now);
+    }
+    ready_queue_push(t);
     t->status = THREAD_READY;
-    if (cur != idle_thread && t->priority > cur->priority)
+    if (cur != idle_thread && preempts(t, cur))
         if (intr_context())
             intr_yield_on_return();
         else
@@ -330,14 +526,33 @@ void thread_exit(void)
      and schedule another process.  That process will destroy us
      when it calls thread_schedule_tail(). */
     intr_disable();
+    if (thread_fair)
+        fair_charge(thread_current());
+    dl_total_bw -= deadline_bw(thread_current()->dl_runtime,
+                               thread_current()->dl_period);
     list_remove(&thread_current()->allelem);
     thread_current()->status = THREAD_DYING;
     schedule();
     NOT_REACHED();
 }
 
+/* Makes T, which its CPU group or the deadline class parked,
+   ready to run, unless it has to be parked again.  Interrupts
+   must be off. */
+void thread_unpark(struct thread *t)
+{
+    ASSERT(is_thread(t));
+    ASSERT(intr_get_level() == INTR_OFF);
+    ASSERT(t->status == THREAD_PARKED);
+
+    t->status = THREAD_BLOCKED;
+    thread_unblock(t);
+}
+
 /* Yields the CPU.  The current thread is not put to sleep and
-   may be scheduled again immediately at the scheduler's whim. */
+   may be scheduled again immediately at the scheduler's whim,
+   unless its CPU group is throttled, in which case it is parked
+   until the group's next period. */
 void thread_yield(void)
 {
     struct thread *cur = thread_current();
@@ -346,9 +561,16 @@ void thread_yield(void)
     ASSERT(!intr_context());
 
     old_level = intr_disable();
-    if (cur != idle_thread)
-        list_push_back(&ready_list, &cur->elem);
-    cur->status = THREAD_READY;
+    if (thread_fair)
+        fair_charge(cur);
+    if (cur != idle_thread && (deadline_park(cur) || cpu_group_park(cur)))
+        cur->status = THREAD_PARKED;
+    else
+    {
+        if (cur != idle_thread)
+            ready_queue_push(cur);
+        cur->status = THREAD_READY;
+    }
     schedule();
     intr_set_level(old_level);
 }
@@ -369,13 +591,11 @@ void thread_foreach(thread_action_func *func, void *aux)
     }
 }
 
-/* Sets the current thread's priority to NEW_PRIORITY.
-   If it is not related to donation, set the original
-   priority, too. If there is donators of the current
-   thread and NEW_PRIORITY is lower than the most
-   powerful donator, just return. If there is any
-   thread with higher priority than the current
-   thread, the current thread should yield. */
+/* Sets the current thread's original priority to NEW_PRIORITY.
+   Its effective priority stays raised while some holder of a
+   lock it owns donates more than that.  If there is any thread
+   with higher priority than the current thread, the current
+   thread yields. */
 void thread_set_priority(int new_priority)
 {
     if (thread_mlfqs)
@@ -383,41 +603,182 @@ void thread_set_priority(int new_priority)
 
     struct thread *cur = thread_current();
 
-    if (!list_empty(&cur->donators))
-    {
-        struct list_elem *max_e = list_max(&cur->donators, less_priority, 1);
+    cur->original_priority = new_priority;
+    thread_update_priority(cur);
+}
 
-        if (new_priority < list_entry(max_e, struct thread, doelem)->priority)
-        {
-            cur->original_priority = new_priority;
-            return;
-        }
+/* Recomputes T's effective priority as the higher of its
+   original priority and the priority donated through the locks
+   it holds.  T->held_locks keeps the lock with the highest
+   donation on top, so only that one needs to be examined.  If T is the running thread and no
+   longer has the highest priority, it yields. */
+void thread_update_priority(struct thread *t)
+{
+    int priority = t->original_priority;
+
+    if (!heap_empty(&t->held_locks))
+    {
+        struct lock *l = heap_entry(heap_top(&t->held_locks), struct lock, elem);
+        if (l->max_priority > priority)
+            priority = l->max_priority;
     }
-    else
-        cur->original_priority = new_priority;
+    thread_change_priority(t, priority);
+    if (t == running_thread() && !intr_context()
+        && t->priority < ready_queue_max_priority())
+        thread_yield();
+}
 
-    cur->priority = new_priority;
-    if (!list_empty(&ready_list))
+/* Sets T's effective priority to NEW_PRIORITY without touching
+   its original priority, as priority donation does.  If T is in
+   the run queue, it is moved to the tail of the queue for its
+   new priority, unless the fair-share scheduler, which ignores
+   priorities, is in use; if it is in a semaphore's or condition
+   variable's waiters heap, it is repositioned there.  Does not
+   preempt the running thread. */
+void thread_change_priority(struct thread *t, int new_priority)
+{
+    enum intr_level old_level;
+    bool requeue;
+
+    ASSERT(t != NULL);
+    ASSERT(PRI_MIN <= new_priority && new_priority <= PRI_MAX);
+
+    old_level = intr_disable();
+    if (t->priority != new_priority)
     {
-        struct list_elem *max_e = list_max(&ready_list, less_priority, NULL);
+        requeue = t->status == THREAD_READY && !thread_fair;
+        if (requeue)
+            ready_queue_remove(t);
+        t->priority = new_priority;
+        if (requeue)
+            ready_queue_push(t);
+        if (t->wait_heap != NULL)
+            heap_update(t->wait_heap, &t->waitelem);
+    }
+    intr_set_level(old_level);
+}
 
-        if (cur->priority < list_entry(max_e, struct thread, elem)->priority)
-            thread_yield();
+/* Moves the current thread into the deadline class, in which it
+   may run for RUNTIME timer ticks in every PERIOD ticks, ahead
+   of all threads outside the class, with its first deadline
+   PERIOD ticks from now.  If RUNTIME is 0, moves it out of the
+   class instead.  Returns false, without doing anything, if
+   RUNTIME is greater than PERIOD or if admitting the thread
+   would leave the deadline class too little time to meet all
+   its deadlines. */
+bool thread_set_deadline(int64_t runtime, int64_t period)
+{
+    struct thread *cur = thread_current();
+    enum intr_level old_level;
+    int bw;
+
+    if (runtime < 0 || (runtime > 0 && (period <= 0 || runtime > period)))
+        return false;
+    if (runtime == 0)
+        period = 0;
+    bw = deadline_bw(runtime, period);
+
+    old_level = intr_disable();
+    if (dl_total_bw - deadline_bw(cur->dl_runtime, cur->dl_period) + bw > DL_BW_MAX)
+    {
+        intr_set_level(old_level);
+        return false;
     }
+    dl_total_bw += bw - deadline_bw(cur->dl_runtime, cur->dl_period);
+    cur->dl_runtime = runtime;
+    cur->dl_period = period;
+    cur->dl_throttled = false;
+    cur->dl_job_done = false;
+    cur->dl_deadline = timer_ticks();
+    if (period != 0)
+        deadline_replenish(cur, cur->dl_deadline);
+    intr_set_level(old_level);
+
+    /* Leaving the class may let some other thread go first. */
+    if (period == 0)
+        thread_yield();
+    return true;
 }
 
-/* If the current thread has no donators, return its
-   original priority. Otherwise, return the highest
-   priority among donators. */
-int thread_get_priority(void)
+/* Ends the current job of the current thread, which must be in
+   the deadline class: waits until its deadline, when its budget
+   is replenished for the next job.  A job that ends after its
+   deadline counts as a deadline miss. */
+void thread_deadline_wait(void)
 {
     struct thread *cur = thread_current();
+    enum intr_level old_level;
+    int64_t now;
 
-    if (thread_mlfqs || list_empty(&cur->donators))
-        return cur->original_priority;
+    ASSERT(cur->dl_period != 0);
+
+    old_level = intr_disable();
+    now = timer_ticks();
+    if (now > cur->dl_deadline)
+        cur->dl_misses++;
+    if (now < cur->dl_deadline)
+    {
+        cur->dl_throttled = true;
+        cur->dl_job_done = true;
+        thread_yield();
+    }
+    else
+    {
+        cur->dl_throttled = false;
+        deadline_replenish(cur, now);
+    }
+    intr_set_level(old_level);
+}
 
-    struct list_elem *max_e = list_max(&cur->donators, less_priority, 1);
-    return list_entry(max_e, struct thread, doelem)->priority;
+/* Returns the number of deadlines that the current thread has
+   missed while in the deadline class. */
+long long
+thread_get_deadline_misses(void)
+{
+    return thread_current()->dl_misses;
+}
+
+/* Replenishes the budget of each throttled thread in the
+   deadline class whose deadline has arrived by tick NOW, and
+   makes it ready to run.  A thread whose job ran out of budget
+   rather than ending in thread_deadline_wait() is still running
+   it at its deadline, which counts as a deadline miss.  Called by
+   the timer interrupt at every tick. */
+void thread_deadline_expire(int64_t now)
+{
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    while (!list_empty(&dl_throttled))
+    {
+        struct thread *t = list_entry(list_front(&dl_throttled), struct thread, elem);
+        if (t->dl_deadline > now)
+            break;
+
+        list_pop_front(&dl_throttled);
+        if (!t->dl_job_done)
+            t->dl_misses++;
+        t->dl_throttled = false;
+        t->dl_job_done = false;
+        deadline_replenish(t, now);
+        thread_unpark(t);
+    }
+}
+
+/* Returns the earliest tick at which a throttled thread in the
+   deadline class is replenished, or INT64_MAX if none is
+   throttled. */
+int64_t
+thread_deadline_next_replenish(void)
+{
+    if (list_empty(&dl_throttled))
+        return INT64_MAX;
+    return list_entry(list_front(&dl_throttled), struct thread, elem)->dl_deadline;
+}
+
+/* Returns the current thread's effective priority. */
+int thread_get_priority(void)
+{
+    return thread_current()->priority;
 }
 
 /* Sets the current thread's nice value to NEW_NICE. */
@@ -425,7 +786,8 @@ void thread_set_nice(int new_nice)
 {
     struct thread *cur = thread_current();
     cur->nice = new_nice;
-    update_priority(cur, 1);
+    if (!thread_fair)
+        update_priority(cur, 1);
 }
 
 /* Returns the current thread's nice value. */
@@ -455,30 +817,6 @@ int thread_get_recent_cpu(void)
     return ret;
 }
 
-/* Returns sleep list */
-struct list *get_sleep_list(void)
-{
-    return &sleep_list;
-}
-
-/* Returns the current thread's donators list. */
-struct list *thread_get_donators(void)
-{
-    return &thread_current()->donators;
-}
-
-/* Sets the current thread's donee to NEW_DONEE. */
-void thread_set_donee(struct thread *new_donee)
-{
-    thread_current()->donee = new_donee;
-}
-
-/* Returns the current thread's donee. */
-struct thread *thread_get_donee(void)
-{
-    return thread_current()->donee;
-}
-
 #ifdef USERPROG
 
 /* Sets the current thread's pagedir to NEW_PAGEDIR. */
@@ -538,19 +876,6 @@ struct file *thread_get_running_file(void)
 
 #endif
 
-/* Compares priority of two list elements A and B. If
-   aux is 1, A and B are elements of donators list.
-   Returns true if A is less than B, or false if A is
-   greater than or equal to B. */
-bool less_priority(const struct list_elem *a, const struct list_elem *b, void *aux)
-{
-    const struct thread *a_t = (aux == 1) ? list_entry(a, struct thread, doelem)
-                                          : list_entry(a, struct thread, elem);
-    const struct thread *b_t = (aux == 1) ? list_entry(b, struct thread, doelem)
-                                          : list_entry(b, struct thread, elem);
-    return a_t->priority < b_t->priority;
-}
-
 /* Idle thread.  Executes when no other thread is ready to run.
 
    The idle thread is initially put on the ready list by
@@ -569,10 +894,28 @@ idle(void *idle_started_ UNUSED)
 
     for (;;)
     {
+        /* Use the spare time to zero free pages.  thread_unblock()
+         never preempts the idle thread, so give way between
+         pages to any thread that an interrupt has woken.  The
+         timer may still be in one-shot mode, which only stands
+         for idle ticks, so restore the periodic tick first. */
+        while (palloc_prezero_page())
+            if (ready_cnt != 0)
+            {
+                intr_disable();
+                timer_idle_exit();
+                thread_yield();
+                intr_enable();
+            }
+
         /* Let someone else run. */
         intr_disable();
+        timer_idle_exit();
         thread_block();
 
+        /* Stop the periodic timer tick, if enabled. */
+        timer_idle_enter();
+
         /* Re-enable interrupts and wait for the next one.
 
          The `sti' instruction disables interrupts until the
@@ -618,6 +961,16 @@ running_thread(void)
     return pg_round_down(esp);
 }
 
+/* Returns the time-stamp counter. */
+static uint64_t
+rdtsc(void)
+{
+    uint64_t tsc;
+    asm volatile("rdtsc"
+                 : "=A"(tsc));
+    return tsc;
+}
+
 /* Returns true if T appears to point to a valid thread. */
 static bool
 is_thread(struct thread *t)
@@ -641,8 +994,10 @@ init_thread(struct thread *t, const char *name, int priority)
     strlcpy(t->name, name, sizeof t->name);
     t->stack = (uint8_t *)t + PGSIZE;
     t->priority = t->original_priority = priority;
-    list_init(&t->donators);
-    t->donee = NULL;
+    heap_init(&t->held_locks, lock_less_priority, NULL);
+    t->waiting_lock = NULL;
+    t->waiting_cond = NULL;
+    t->wait_heap = NULL;
     if (thread_mlfqs)
     {
         t->nice = (t == initial_thread)
@@ -651,10 +1006,12 @@ init_thread(struct thread *t, const char *name, int priority)
         t->recent_cpu = (t == initial_thread)
                             ? int_to_fixed(0)
                             : thread_current()->recent_cpu;
+        t->decay_epoch = decay_epoch;
         update_priority(t, NULL);
     }
+    else if (thread_fair)
+        t->nice = (t == initial_thread) ? 0 : thread_current()->nice;
 
-    list_init(&t->spt);
     list_init(&t->mmap_file_list);
 #ifdef USERPROG
     t->pcb = NULL;
@@ -665,6 +1022,8 @@ init_thread(struct thread *t, const char *name, int priority)
     t->magic = THREAD_MAGIC;
 
     old_level = intr_disable();
+    t->vruntime = min_vruntime;
+    t->cpu_group = (t == initial_thread) ? NULL : running_thread()->cpu_group;
     list_push_back(&all_list, &t->allelem);
     intr_set_level(old_level);
 }
@@ -682,25 +1041,99 @@ alloc_frame(struct thread *t, size_t size)
     return t->stack;
 }
 
+/* Appends T to the run queue for its priority, or inserts it
+   into the deadline or fair-share run queue. */
+static void
+ready_queue_push(struct thread *t)
+{
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (t->dl_period != 0)
+        heap_insert(&dl_queue, &t->readyelem);
+    else if (thread_fair)
+        heap_insert(&fair_queue, &t->readyelem);
+    else
+    {
+        list_push_back(&ready_queues[t->priority], &t->elem);
+        ready_bitmap |= (uint64_t)1 << t->priority;
+    }
+    ready_cnt++;
+}
+
+/* Removes T, which must be in the run queue, from it. */
+static void
+ready_queue_remove(struct thread *t)
+{
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (t->dl_period != 0)
+        heap_remove(&dl_queue, &t->readyelem);
+    else if (thread_fair)
+        heap_remove(&fair_queue, &t->readyelem);
+    else
+    {
+        list_remove(&t->elem);
+        if (list_empty(&ready_queues[t->priority]))
+            ready_bitmap &= ~((uint64_t)1 << t->priority);
+    }
+    ready_cnt--;
+}
+
+/* Returns the highest priority among threads in the run queue,
+   or PRI_MIN - 1 if the run queue is empty.  Always returns
+   PRI_MIN - 1 under the fair-share scheduler, which never lets
+   priority decide what runs next. */
+static int
+ready_queue_max_priority(void)
+{
+    uint32_t high = ready_bitmap >> 32, low = ready_bitmap;
+
+    if (high != 0)
+        return 63 - __builtin_clz(high);
+    else if (low != 0)
+        return 31 - __builtin_clz(low);
+    else
+        return PRI_MIN - 1;
+}
+
 /* Chooses and returns the next thread to be scheduled.  Should
    return a thread from the run queue, unless the run queue is
    empty.  (If the running thread can continue running, then it
    will be in the run queue.)  If the run queue is empty, return
-   idle_thread. Picks one thread with the highest priority when
-   choosing the next one. */
+   idle_thread. Picks the thread in the deadline class with the
+   earliest deadline, if any is ready.  Otherwise, picks the
+   thread at the front of the queue with the highest priority,
+   or the thread with the least virtual runtime under the
+   fair-share scheduler. */
 static struct thread *
 next_thread_to_run(void)
 {
-    if (list_empty(&ready_list))
-        return idle_thread;
-    else
+    int max_priority = ready_queue_max_priority();
+    struct thread *max_t;
+
+    if (!heap_empty(&dl_queue))
     {
-        struct list_elem *max_e = list_max(&ready_list, less_priority, NULL);
-        struct thread *max_t = list_entry(max_e, struct thread, elem);
+        max_t = heap_entry(heap_top(&dl_queue), struct thread, readyelem);
+        ready_queue_remove(max_t);
+        return max_t;
+    }
 
-        list_remove(max_e);
+    if (thread_fair)
+    {
+        if (heap_empty(&fair_queue))
+            return idle_thread;
+        max_t = heap_entry(heap_top(&fair_queue), struct thread, readyelem);
+        ready_queue_remove(max_t);
         return max_t;
     }
+
+    if (max_priority < PRI_MIN)
+        return idle_thread;
+
+    max_t = list_entry(list_front(&ready_queues[max_priority]),
+                       struct thread, elem);
+    ready_queue_remove(max_t);
+    return max_t;
 }
 
 /* Completes a thread switch by activating the new thread's page
@@ -744,7 +1177,7 @@ void thread_schedule_tail(struct thread *prev)
     if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread)
     {
         ASSERT(prev != cur);
-        palloc_free_page(prev);
+        thread_page_put(prev);
     }
 }
 
@@ -776,15 +1209,45 @@ static tid_t
 allocate_tid(void)
 {
     static tid_t next_tid = 1;
+    enum intr_level old_level;
     tid_t tid;
 
-    lock_acquire(&tid_lock);
+    old_level = intr_disable();
     tid = next_tid++;
-    lock_release(&tid_lock);
+    intr_set_level(old_level);
 
     return tid;
 }
 
+/* Returns a page for a new thread, preferably one cached by
+   thread_page_put(), or a null pointer if none is available. */
+static struct thread *
+thread_page_get(void)
+{
+    enum intr_level old_level;
+    void *page = NULL;
+
+    old_level = intr_disable();
+    if (thread_page_cache_cnt > 0)
+        page = thread_page_cache[--thread_page_cache_cnt];
+    intr_set_level(old_level);
+
+    return page != NULL ? page : palloc_get_page(0);
+}
+
+/* Releases the page of dead thread T, keeping it for reuse if
+   the cache has room.  Interrupts must be off. */
+static void
+thread_page_put(struct thread *t)
+{
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (thread_page_cache_cnt < THREAD_PAGE_CACHE_MAX)
+        thread_page_cache[thread_page_cache_cnt++] = t;
+    else
+        palloc_free_page(t);
+}
+
 /* Updates priority of T. */
 static void
 update_priority(struct thread *t, void *aux)
@@ -799,41 +1262,229 @@ update_priority(struct thread *t, void *aux)
         new_priority = PRI_MAX;
     if (new_priority < PRI_MIN)
         new_priority = PRI_MIN;
-    t->priority = t->original_priority = new_priority;
+    t->original_priority = new_priority;
+    thread_change_priority(t, new_priority);
 
     struct thread *cur = running_thread();
     if (t == cur && aux == 1)
-        if (!list_empty(&ready_list))
-        {
-            struct list_elem *max_e = list_max(&ready_list, less_priority, NULL);
-
-            if (cur->priority < list_entry(max_e, struct thread, elem)->priority)
-                thread_yield();
-        }
+        if (cur->priority < ready_queue_max_priority())
+            thread_yield();
 }
 
-/* Updates recent cpu of T. */
+/* Brings recent cpu of T up to date by applying every decay it
+   has missed since it was last examined, and updates its
+   priority if recent cpu changed.  Decays older than the
+   history kept in decay_coefficients[] are approximated with
+   the oldest coefficient still remembered, stopping early once
+   recent cpu stops changing. */
 static void
 update_recent_cpu(struct thread *t, void *aux UNUSED)
 {
+    int oldest_epoch = decay_epoch - DECAY_HISTORY + 1,
+        old_recent_cpu = t->recent_cpu, new_recent_cpu;
+
     if (t == idle_thread)
         return;
+    while (t->decay_epoch < oldest_epoch - 1)
+    {
+        new_recent_cpu = fixed_plus_int(fixed_mul_fixed(decay_coefficients[oldest_epoch % DECAY_HISTORY], t->recent_cpu), t->nice);
+        t->decay_epoch++;
+        if (new_recent_cpu == t->recent_cpu)
+            t->decay_epoch = oldest_epoch - 1;
+        t->recent_cpu = new_recent_cpu;
+    }
+    while (t->decay_epoch < decay_epoch)
+    {
+        t->decay_epoch++;
+        t->recent_cpu = fixed_plus_int(fixed_mul_fixed(decay_coefficients[t->decay_epoch % DECAY_HISTORY], t->recent_cpu), t->nice);
+    }
+
+    if (t->recent_cpu != old_recent_cpu)
+        update_priority(t, NULL);
+}
+
+/* Starts a new recent cpu decay with a coefficient computed
+   from the current load avg, and applies it right away to the
+   running thread and every thread in the run queue, whose
+   priorities decide what runs next.  Blocked threads catch up
+   in thread_unblock(). */
+static void
+decay_recent_cpu(void)
+{
     int load_avg_term = fixed_mul_int(load_avg, 2),
         coefficient = fixed_div_fixed(load_avg_term, fixed_plus_int(load_avg_term, 1));
-    t->recent_cpu = fixed_plus_int(fixed_mul_fixed(coefficient, t->recent_cpu), t->nice);
+    int i;
+
+    decay_coefficients[++decay_epoch % DECAY_HISTORY] = coefficient;
+    update_recent_cpu(running_thread(), NULL);
+
+    /* A thread whose priority changes moves to the tail of
+     another queue and may be visited again, which is harmless
+     because it is already up to date by then. */
+    for (i = PRI_MIN; i <= PRI_MAX; i++)
+    {
+        struct list_elem *e = list_begin(&ready_queues[i]);
+
+        while (e != list_end(&ready_queues[i]))
+        {
+            struct thread *t = list_entry(e, struct thread, elem);
+
+            e = list_next(e);
+            update_recent_cpu(t, NULL);
+        }
+    }
 }
 
 /* Updates load avg. */
 static void
 update_load_avg(void)
 {
-    int ready_threads = list_size(&ready_list);
+    int ready_threads = ready_cnt;
     if (thread_current() != idle_thread)
         ready_threads++;
     int load_avg_term = fixed_mul_int(load_avg, 59);
     load_avg = fixed_div_int(fixed_plus_int(load_avg_term, ready_threads), 60);
 }
 
+/* Returns true if thread A has more virtual runtime than thread
+   B, so that the fair-share run queue keeps the thread with the
+   least virtual runtime on top. */
+static bool
+more_vruntime(const struct heap_elem *a_, const struct heap_elem *b_,
+              void *aux UNUSED)
+{
+    const struct thread *a = heap_entry(a_, struct thread, readyelem);
+    const struct thread *b = heap_entry(b_, struct thread, readyelem);
+
+    return a->vruntime > b->vruntime;
+}
+
+/* Charges running thread CUR for the CPU time it used since the
+   last call, scaled by its weight, and advances min_vruntime.
+   The idle thread is never charged.  Interrupts must be off.
+
+   A thread is never credited: should the clock appear to go
+   backward, nothing is charged, so vruntime cannot decrease. */
+static void
+fair_charge(struct thread *cur)
+{
+    int64_t now_ns = timer_ns(), delta_ns, vruntime;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    delta_ns = now_ns - fair_charged_ns;
+    if (delta_ns < 0)
+        delta_ns = 0;
+    else
+        fair_charged_ns = now_ns;
+
+    if (cur != idle_thread)
+    {
+        cur->vruntime += delta_ns * FAIR_WEIGHT_NICE_0 / fair_weight(cur->nice);
+
+        vruntime = cur->vruntime;
+        if (!heap_empty(&fair_queue))
+        {
+            struct thread *t = heap_entry(heap_top(&fair_queue), struct thread, readyelem);
+            if (t->vruntime < vruntime)
+                vruntime = t->vruntime;
+        }
+        if (vruntime > min_vruntime)
+            min_vruntime = vruntime;
+    }
+}
+
+/* Returns the fair-share weight of a thread with the given NICE
+   value. */
+static int
+fair_weight(int nice)
+{
+    if (nice < NICE_MIN)
+        nice = NICE_MIN;
+    else if (nice > NICE_MAX)
+        nice = NICE_MAX;
+    return fair_weights[nice - NICE_MIN];
+}
+
+/* Returns true if T, which has just been made ready, should run
+   instead of the running thread CUR. */
+static bool
+preempts(const struct thread *t, const struct thread *cur)
+{
+    if (t->dl_period != 0)
+        return cur->dl_period == 0 || t->dl_deadline < cur->dl_deadline;
+    else if (cur->dl_period != 0)
+        return false;
+    else if (thread_fair)
+        return t->vruntime + FAIR_WAKEUP_GRANULARITY_NS < cur->vruntime;
+    else
+        return t->priority > cur->priority;
+}
+
+/* Returns true if thread A's deadline is later than thread B's,
+   so that the deadline run queue keeps the earliest deadline on
+   top. */
+static bool
+later_deadline(const struct heap_elem *a_, const struct heap_elem *b_,
+               void *aux UNUSED)
+{
+    const struct thread *a = heap_entry(a_, struct thread, readyelem);
+    const struct thread *b = heap_entry(b_, struct thread, readyelem);
+
+    return a->dl_deadline > b->dl_deadline;
+}
+
+/* Returns true if thread A's deadline is earlier than thread
+   B's. */
+static bool
+earlier_deadline(const struct list_elem *a_, const struct list_elem *b_,
+                 void *aux UNUSED)
+{
+    const struct thread *a = list_entry(a_, struct thread, elem);
+    const struct thread *b = list_entry(b_, struct thread, elem);
+
+    return a->dl_deadline < b->dl_deadline;
+}
+
+/* If T is in the deadline class and throttled, parks T until its
+   deadline and returns true.  Otherwise, returns false and does
+   nothing.  Interrupts must be off.
+
+   A thread that ran out of budget while holding locks is not
+   parked, for the same reason as in cpu_group_park(). */
+static bool
+deadline_park(struct thread *t)
+{
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (t->dl_period == 0 || !t->dl_throttled
+        || (!t->dl_job_done && !heap_empty(&t->held_locks)))
+        return false;
+    list_insert_ordered(&dl_throttled, &t->elem, earlier_deadline, NULL);
+    return true;
+}
+
+/* Gives T, in the deadline class, a full budget and moves its
+   deadline to the first period boundary after tick NOW. */
+static void
+deadline_replenish(struct thread *t, int64_t now)
+{
+    t->dl_budget = t->dl_runtime;
+    if (t->dl_deadline <= now)
+        t->dl_deadline += ((now - t->dl_deadline) / t->dl_period + 1) * t->dl_period;
+}
+
+/* Returns the share of the CPU that RUNTIME ticks in every
+   PERIOD ticks amount to, in units of 1 / DL_BW_ONE, rounded
+   up.  Returns 0 for a thread outside the deadline class. */
+static int
+deadline_bw(int64_t runtime, int64_t period)
+{
+    if (period == 0)
+        return 0;
+    return (runtime * DL_BW_ONE + period - 1) / period;
+}
+
 /* Offset of `stack' member within `struct thread'.
    Used by switch.S, which can't figure it out on its own. */
 uint32_t thread_stack_ofs = offsetof(struct thread, stack);
@@ -2,15 +2,20 @@
 #define THREADS_THREAD_H
 
 #include <debug.h>
+#include <hash.h>
+#include <heap.h>
 #include <list.h>
 #include <stdint.h>
 
+struct condition;
+
 /* States in a thread's life cycle. */
 enum thread_status
 {
     THREAD_RUNNING, /* Running thread. */
     THREAD_READY,   /* Not running but ready to run. */
     THREAD_BLOCKED, /* Waiting for an event to trigger. */
+    THREAD_PARKED,  /* Runnable, but held back by its CPU limit. */
     THREAD_DYING    /* About to be destroyed. */
 };
 
@@ -97,15 +102,29 @@ struct thread
     int64_t wake_ticks; /* Ticks to wake up. */
 
     /* Shared between thread.c and synch.c. */
-    int original_priority;   /* Original priority before donation. */
-    struct list donators;    /* List of donators. */
-    struct list_elem doelem; /* List element for donators list. */
-    struct thread *donee;    /* Thread that is given priority. */
+    int original_priority;      /* Original priority before donation. */
+    struct heap held_locks;     /* Held locks, highest max_priority on top. */
+    struct lock *waiting_lock;  /* Lock being waited for, if any. */
+    struct condition *waiting_cond; /* Condition blocked on in cond_wait(), if any. */
+    struct heap_elem waitelem;  /* Heap element for a waiters heap. */
+    struct heap *wait_heap;     /* Waiters heap containing waitelem, if any. */
+    unsigned wait_seq;          /* Arrival order in wait_heap. */
 
     /* Owned by thread.c. */
     int nice;       /* Figure that indicates how nice to others. */
     int recent_cpu; /* Weighted average amount of received CPU time. */
-    struct list spt;
+    int decay_epoch; /* Last recent_cpu decay applied to recent_cpu. */
+    int64_t vruntime;            /* Weighted CPU time, in ns, for -fair. */
+    struct heap_elem readyelem;  /* Heap element for the deadline or -fair run queue. */
+    struct cpu_group *cpu_group; /* CPU bandwidth group, if any. */
+    int64_t dl_runtime;          /* Deadline class budget per period, or 0. */
+    int64_t dl_period;           /* Deadline class period, or 0 if not in it. */
+    int64_t dl_deadline;         /* Tick by which the current job is due. */
+    int64_t dl_budget;           /* Ticks left in the current period. */
+    bool dl_throttled;           /* Waiting for its budget to be replenished? */
+    bool dl_job_done;            /* Ended its job in thread_deadline_wait()? */
+    long long dl_misses;         /* Number of deadlines missed. */
+    struct hash spt;             /* Supplemental page table, for user processes. */
     struct list mmap_file_list;
     struct frame_table_entry* clock_pointer;
     uint8_t *esp;
@@ -129,10 +148,16 @@ struct thread
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* If true, use fair-share scheduler, which ignores priorities.
+   Controlled by kernel command-line option "-fair". */
+extern bool thread_fair;
+
 void thread_init(void);
 void thread_start(void);
 
 void thread_tick(void);
+void thread_idle_tick(void);
+void thread_idle_intr(void);
 void thread_print_stats(void);
 
 typedef void thread_func(void *aux);
@@ -140,6 +165,7 @@ tid_t thread_create(const char *name, int priority, thread_func *, void *);
 
 void thread_block(void);
 void thread_unblock(struct thread *);
+void thread_unpark(struct thread *);
 
 struct thread *thread_current(void);
 tid_t thread_tid(void);
@@ -154,16 +180,20 @@ void thread_foreach(thread_action_func *, void *);
 
 int thread_get_priority(void);
 void thread_set_priority(int);
+void thread_change_priority(struct thread *, int);
 
 int thread_get_nice(void);
 void thread_set_nice(int);
 int thread_get_recent_cpu(void);
 int thread_get_load_avg(void);
 
-struct list *get_sleep_list(void);
-struct list *thread_get_donators(void);
-struct thread *thread_get_donee(void);
-void thread_set_donee(struct thread *);
+void thread_update_priority(struct thread *);
+
+bool thread_set_deadline(int64_t runtime, int64_t period);
+void thread_deadline_wait(void);
+long long thread_get_deadline_misses(void);
+void thread_deadline_expire(int64_t now);
+int64_t thread_deadline_next_replenish(void);
 
 #ifdef USERPROG
 uint32_t *thread_get_pagedir(void);
@@ -177,6 +207,4 @@ struct file *thread_get_running_file(void);
 void thread_set_running_file(struct file *);
 #endif
 
-list_less_func less_priority;
-
 #endif /* threads/thread.h */
@@ -0,0 +1,306 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Work queue.
+
+   Lets a caller, including an interrupt handler, push a function
+   call off its own path: the call is run later by one of a pool
+   of kernel worker threads.  A work item can also be delayed by
+   some number of timer ticks, and a thread can wait for an item
+   to finish.
+
+   All of the queue state is protected by disabling interrupts,
+   so submission never sleeps.  Delayed items are kept in a heap
+   ordered by due tick, which the timer interrupt drains through
+   workqueue_expire(). */
+
+/* Number of worker threads. */
+#define WORKER_CNT 2
+
+/* Items waiting for a worker, in FIFO order. */
+static struct list run_queue;
+
+/* Counts the items in RUN_QUEUE.  May run ahead of it after
+   work_cancel(), which workers tolerate. */
+static struct semaphore run_sema;
+
+/* Delayed items, earliest due tick on top. */
+static struct heap delayed;
+
+/* Statistics. */
+static long long work_cnt;      /* Items run. */
+static size_t queue_depth;      /* Items in RUN_QUEUE. */
+static size_t max_queue_depth;  /* Maximum of queue_depth. */
+static int64_t total_latency_ns; /* Sum of queueing latencies. */
+static int64_t max_latency_ns;  /* Maximum queueing latency. */
+
+static thread_func worker;
+static heap_less_func later_due;
+static void enqueue(struct work *);
+static void wake_waiters(struct work *);
+
+/* Initializes the work queue and starts its worker threads. */
+void workqueue_init(void)
+{
+    int i;
+
+    list_init(&run_queue);
+    sema_init(&run_sema, 0);
+    heap_init(&delayed, later_due, NULL);
+
+    for (i = 0; i < WORKER_CNT; i++)
+    {
+        char name[16];
+        snprintf(name, sizeof name, "kworker %d", i);
+        thread_create(name, PRI_DEFAULT, worker, NULL);
+    }
+}
+
+/* Initializes W to run FUNC with argument AUX. */
+void work_init(struct work *w, work_func *func, void *aux)
+{
+    ASSERT(w != NULL);
+    ASSERT(func != NULL);
+
+    w->func = func;
+    w->aux = aux;
+    w->state = WORK_IDLE;
+    w->running = false;
+    w->waiter_cnt = 0;
+    sema_init(&w->done, 0);
+}
+
+/* Queues W to be run by a worker thread.  Returns false, without
+   doing anything, if W was already delayed or queued.  An item
+   that is running may be queued again, to run once more after it
+   returns.
+
+   This function does not sleep, so it may be called within an
+   interrupt handler. */
+bool work_submit(struct work *w)
+{
+    enum intr_level old_level;
+    bool success = false;
+
+    ASSERT(w != NULL);
+
+    old_level = intr_disable();
+    if (w->state == WORK_IDLE)
+    {
+        enqueue(w);
+        success = true;
+    }
+    intr_set_level(old_level);
+    return success;
+}
+
+/* Queues W to be run by a worker thread once TICKS timer ticks
+   have passed.  Returns false, without doing anything, if W was
+   already delayed or queued.
+
+   This function does not sleep, so it may be called within an
+   interrupt handler. */
+bool work_submit_delayed(struct work *w, int64_t ticks)
+{
+    enum intr_level old_level;
+    bool success = false;
+
+    ASSERT(w != NULL);
+
+    if (ticks <= 0)
+        return work_submit(w);
+
+    old_level = intr_disable();
+    if (w->state == WORK_IDLE)
+    {
+        w->state = WORK_DELAYED;
+        w->due = timer_ticks() + ticks;
+        heap_insert(&delayed, &w->heap_elem);
+        success = true;
+    }
+    intr_set_level(old_level);
+    return success;
+}
+
+/* Takes W off the queue if it is delayed or queued, and returns
+   true if so.  Returns false if W was not queued.  Does not wait
+   for W to return if it is running.
+
+   This function does not sleep, so it may be called within an
+   interrupt handler. */
+bool work_cancel(struct work *w)
+{
+    enum intr_level old_level;
+    bool success = true;
+
+    ASSERT(w != NULL);
+
+    old_level = intr_disable();
+    if (w->state == WORK_DELAYED)
+        heap_remove(&delayed, &w->heap_elem);
+    else if (w->state == WORK_QUEUED)
+    {
+        list_remove(&w->elem);
+        queue_depth--;
+    }
+    else
+        success = false;
+    w->state = WORK_IDLE;
+    wake_waiters(w);
+    intr_set_level(old_level);
+    return success;
+}
+
+/* Waits until W is neither queued nor running, that is, until it
+   has run as many times as it was submitted or has been
+   cancelled.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler, nor from W's own work function. */
+void work_wait(struct work *w)
+{
+    enum intr_level old_level;
+
+    ASSERT(w != NULL);
+    ASSERT(!intr_context());
+
+    old_level = intr_disable();
+    while (work_pending(w))
+    {
+        w->waiter_cnt++;
+        sema_down(&w->done);
+    }
+    intr_set_level(old_level);
+}
+
+/* Returns true if W is delayed, queued, or running. */
+bool work_pending(const struct work *w)
+{
+    ASSERT(w != NULL);
+
+    return w->state != WORK_IDLE || w->running;
+}
+
+/* Moves the delayed items due at or before NOW onto the run
+   queue.  Called by the timer interrupt handler on every
+   tick. */
+void workqueue_expire(int64_t now)
+{
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    while (!heap_empty(&delayed))
+    {
+        struct work *w = heap_entry(heap_top(&delayed), struct work, heap_elem);
+        if (w->due > now)
+            break;
+        heap_pop(&delayed);
+        enqueue(w);
+    }
+}
+
+/* Returns the tick at which the earliest delayed item is due, or
+   INT64_MAX if there is none.  Interrupts must be off. */
+int64_t
+workqueue_next_due(void)
+{
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (heap_empty(&delayed))
+        return INT64_MAX;
+    return heap_entry(heap_top(&delayed), struct work, heap_elem)->due;
+}
+
+/* Prints work queue statistics. */
+void workqueue_print_stats(void)
+{
+    printf("Workqueue: %lld items run, queue depth %zu (max %zu), "
+           "latency %lld ns average, %lld ns worst-case\n",
+           work_cnt, queue_depth, max_queue_depth,
+           work_cnt > 0 ? total_latency_ns / work_cnt : 0,
+           max_latency_ns);
+}
+
+/* Worker thread.  Runs queued items one at a time, forever. */
+static void
+worker(void *aux UNUSED)
+{
+    for (;;)
+    {
+        enum intr_level old_level;
+        struct work *w;
+        int64_t latency;
+
+        sema_down(&run_sema);
+
+        old_level = intr_disable();
+        if (list_empty(&run_queue))
+        {
+            /* The item counted by run_sema was cancelled. */
+            intr_set_level(old_level);
+            continue;
+        }
+        w = list_entry(list_pop_front(&run_queue), struct work, elem);
+        queue_depth--;
+        w->state = WORK_IDLE;
+        w->running = true;
+        latency = timer_ns() - w->queued_ns;
+        work_cnt++;
+        total_latency_ns += latency;
+        if (latency > max_latency_ns)
+            max_latency_ns = latency;
+        intr_set_level(old_level);
+
+        w->func(w->aux);
+
+        old_level = intr_disable();
+        w->running = false;
+        wake_waiters(w);
+        intr_set_level(old_level);
+    }
+}
+
+/* Appends W to the run queue and wakes up a worker.  Interrupts
+   must be off. */
+static void
+enqueue(struct work *w)
+{
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    w->state = WORK_QUEUED;
+    w->queued_ns = timer_ns();
+    list_push_back(&run_queue, &w->elem);
+    if (++queue_depth > max_queue_depth)
+        max_queue_depth = queue_depth;
+    sema_up(&run_sema);
+}
+
+/* Wakes up the threads waiting for W, if it is no longer
+   pending.  Interrupts must be off. */
+static void
+wake_waiters(struct work *w)
+{
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (work_pending(w))
+        return;
+    while (w->waiter_cnt > 0)
+    {
+        w->waiter_cnt--;
+        sema_up(&w->done);
+    }
+}
+
+/* Compares the due ticks of two delayed items A and B.  Treats
+   the one due later as less, so that the earliest is on top of
+   the heap. */
+static bool
+later_due(const struct heap_elem *a, const struct heap_elem *b, void *aux UNUSED)
+{
+    const struct work *a_w = heap_entry(a, struct work, heap_elem);
+    const struct work *b_w = heap_entry(b, struct work, heap_elem);
+    return a_w->due > b_w->due;
+}
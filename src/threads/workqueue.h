@@ -0,0 +1,50 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <heap.h>
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "threads/synch.h"
+
+/* Function run by a worker thread for a work item, given the
+   auxiliary data AUX it was initialized with. */
+typedef void work_func(void *aux);
+
+/* Where a work item is queued. */
+enum work_state
+{
+    WORK_IDLE,    /* Not queued. */
+    WORK_DELAYED, /* Waiting for its due tick. */
+    WORK_QUEUED   /* Waiting for a worker thread. */
+};
+
+/* A work item.  The caller owns the memory, which must stay
+   valid until the item is idle again. */
+struct work
+{
+    work_func *func;            /* Function to run. */
+    void *aux;                  /* Argument to FUNC. */
+    enum work_state state;      /* Where it is queued. */
+    bool running;               /* Being run by a worker thread? */
+    struct list_elem elem;      /* Element in the run queue. */
+    struct heap_elem heap_elem; /* Element in the delayed heap. */
+    int64_t due;                /* Tick at which delayed work is queued. */
+    int64_t queued_ns;          /* When queued, for latency statistics. */
+    unsigned waiter_cnt;        /* Threads in work_wait(). */
+    struct semaphore done;      /* Upped for each waiter when idle. */
+};
+
+void workqueue_init(void);
+void workqueue_expire(int64_t now);
+int64_t workqueue_next_due(void);
+void workqueue_print_stats(void);
+
+void work_init(struct work *, work_func *, void *aux);
+bool work_submit(struct work *);
+bool work_submit_delayed(struct work *, int64_t ticks);
+bool work_cancel(struct work *);
+void work_wait(struct work *);
+bool work_pending(const struct work *);
+
+#endif /* threads/workqueue.h */
@@ -7,12 +7,12 @@
 #include "threads/thread.h"
 #include "vm/frame.h"
 #include "vm/page.h"
+#include "vm/swap.h"
 #include "threads/vaddr.h"
 #include "threads/synch.h"
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
-extern frame_table_lock;
 
 static void kill(struct intr_frame *);
 static void page_fault(struct intr_frame *);
@@ -165,7 +165,8 @@ page_fault(struct intr_frame *f)
     // struct spte* page2 = find_page_from_frame(fault_addr);
     if (is_user_vaddr(fault_addr)&&fault_addr>0x08048000 && not_present){
       struct spte* page = find_page(fault_addr);
-      struct spte* total_page = find_page_from_spts(fault_addr);
+      if(page)
+        frame_wait_evicted(page);
             
 
       /*if (fault_addr > (uint8_t*)PHYS_BASE - 8 * 1024 * 1024){
@@ -307,13 +308,13 @@ page_fault(struct intr_frame *f)
             if(!install_page(page->page_number, frame->frame_number, page->writable)){
               is_valid = false;
             } else {
-              if(!lock_held_by_current_thread(&frame_table_lock)){
-                lock_acquire(&frame_table_lock);  
+              if(!rwlock_held_by_current_thread(&frame_table_lock)){
+                rwlock_acquire_write(&frame_table_lock);  
               }
               frame->mapped_page = page;
               page->frame_number = frame->frame_number;
-              if(lock_held_by_current_thread(&frame_table_lock))
-                lock_release(&frame_table_lock);
+              if(rwlock_held_by_current_thread(&frame_table_lock))
+                rwlock_release_write(&frame_table_lock);
             }
           } else{
             deallocate_frame(frame->frame_number);
@@ -328,19 +329,21 @@ page_fault(struct intr_frame *f)
             is_valid = true;
           }
           if(is_valid){
+            /* Read the page in before the frame is mapped, so that
+               the clock cannot choose it while the read is under way. */
+            swap_read(page, frame->frame_number);
             if(!install_page(page->page_number, frame->frame_number, page->writable)){
               deallocate_frame(frame->frame_number);
               is_valid = false;
             } else {
-              if(!lock_held_by_current_thread(&frame_table_lock)){
-                lock_acquire(&frame_table_lock);  
+              if(!rwlock_held_by_current_thread(&frame_table_lock)){
+                rwlock_acquire_write(&frame_table_lock);  
               }
               page->frame_number = frame->frame_number;
               frame->mapped_page = page;
-              if(lock_held_by_current_thread(&frame_table_lock)){
-                lock_release(&frame_table_lock);
+              if(rwlock_held_by_current_thread(&frame_table_lock)){
+                rwlock_release_write(&frame_table_lock);
               }
-              swap_read(page->page_number, page->frame_number);
             }
           }
         }
@@ -371,7 +374,7 @@ page_fault(struct intr_frame *f)
               // ptr = fault_addr;
               success = install_page(pg_round_down(ptr), frame->frame_number, true);
               if (success){
-                  struct spte* page = malloc(sizeof(struct spte));
+                  struct spte* page = spte_alloc();
                   frame->mapped_page = page;
 
                   if(page==NULL){
@@ -384,7 +387,7 @@ page_fault(struct intr_frame *f)
                   page->writable = true;
                   page->page_number = pg_round_down(ptr);
                   page->frame_number = frame->frame_number;
-                  list_push_back(&thread_current()->spt, &page->spt_elem);
+                  spt_insert(page);
                   is_valid=true;
               }
               else
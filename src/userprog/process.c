@@ -20,6 +20,7 @@
 #include "threads/vaddr.h"
 #include "vm/frame.h"
 #include "vm/page.h"
+#include "vm/mmap.h"
 
 static thread_func start_process NO_RETURN;
 static bool load(const char *cmdline, void (**eip)(void), void **esp);
@@ -33,26 +34,19 @@ static void push_arguments(int argc, char **argv, void **esp);
    thread id, or TID_ERROR if the thread cannot be created. */
 tid_t process_execute(const char *file_name)
 {
-    char *fn_copy1, *fn_copy2, *thread_name, *save_ptr;
+    char thread_name[16], *fn_copy, *save_ptr;
     tid_t tid;
     struct process *pcb;
 
-    /* Make copies of FILE_NAME.
-     Otherwise there's a race between the caller and load(). */
-    fn_copy1 = palloc_get_page(0);
-    if (!fn_copy1)
-        return TID_ERROR;
-    strlcpy(fn_copy1, file_name, PGSIZE);
-    fn_copy2 = palloc_get_page(0);
-    if (!fn_copy2)
-        return TID_ERROR;
-    strlcpy(fn_copy2, file_name, PGSIZE);
-
-    /* Create a process control block for the new process. */
+    /* Create a process control block for the new process, with a
+     copy of FILE_NAME in the rest of its page.  Otherwise there's
+     a race between the caller and load(). */
     pcb = palloc_get_page(0);
     if (!pcb)
         return TID_ERROR;
-    pcb->file_name = fn_copy1;
+    fn_copy = (char *)(pcb + 1);
+    strlcpy(fn_copy, file_name, PGSIZE - sizeof *pcb);
+    pcb->file_name = fn_copy;
     pcb->parent = thread_current();
     pcb->is_loaded = false;
     sema_init(&pcb->load_sema, 0);
@@ -61,13 +55,13 @@ tid_t process_execute(const char *file_name)
     pcb->exit_status = -1;
 
     /* Create a new thread to execute FILE_NAME. */
-    thread_name = strtok_r(fn_copy2, " ", &save_ptr);
+    strlcpy(thread_name, file_name, sizeof thread_name);
+    strtok_r(thread_name, " ", &save_ptr);
     tid = thread_create(thread_name, PRI_DEFAULT, start_process, pcb);
     if (tid == TID_ERROR)
     {
-        palloc_free_page(fn_copy1);
         palloc_free_page(pcb);
-        goto done;
+        return TID_ERROR;
     }
 
     /* Wait until child process's program is loaded. If it
@@ -76,8 +70,6 @@ tid_t process_execute(const char *file_name)
     if (pcb->pid != PID_ERROR)
         list_push_back(thread_get_children(), &pcb->childelem);
 
-done:
-    palloc_free_page(fn_copy2);
     return tid;
 }
 
@@ -91,7 +83,7 @@ start_process(void *pcb_)
     bool success;
     int argc = 0;
     char *argv[MAX_ARGS];
-    char *file_name = pcb->file_name;
+    char *file_name = (char *)pcb->file_name;
 
     /* Set the current process's pcb to PCB. */
     thread_set_pcb(pcb);
@@ -113,7 +105,6 @@ start_process(void *pcb_)
         push_arguments(argc, argv, &if_.esp);
 
     /* If load failed, quit. */
-    palloc_free_page(file_name);
     if (!success)
         syscall_exit(-1);
 
@@ -161,7 +152,7 @@ void process_exit(void)
     struct process *pcb = thread_get_pcb();
     struct list *children = thread_get_children();
     struct list_elem *e;
-    struct lock *filesys_lock = syscall_get_filesys_lock();
+    struct rwlock *filesys_lock = syscall_get_filesys_lock();
     uint32_t *pd;
     int max_fd = thread_get_next_fd(), i;
 
@@ -179,10 +170,10 @@ void process_exit(void)
 
     /* Close the running file. */
     // if(!lock_held_by_current_thread(&filesys_lock))
-        lock_acquire(filesys_lock);
+        rwlock_acquire_write(filesys_lock);
     file_close(thread_get_running_file());
     // if(lock_held_by_current_thread(&filesys_lock))
-      lock_release(filesys_lock);
+      rwlock_release_write(filesys_lock);
 
     /* Destroy the current process's page directory and switch back
      to the kernel-only page directory. */
@@ -198,7 +189,6 @@ void process_exit(void)
          that's been freed (and cleared). */
         clear_mmap_file_list();
         clear_spt();
-        clear_swap_table();
         thread_set_pagedir(NULL);
         pagedir_activate(NULL);
         pagedir_destroy(pd);
@@ -346,19 +336,25 @@ bool load(const char *file_name, void (**eip)(void), void **esp)
     struct thread *t = thread_current();
     struct Elf32_Ehdr ehdr;
     struct file *file = NULL;
-    struct lock *filesys_lock = syscall_get_filesys_lock();
+    struct rwlock *filesys_lock = syscall_get_filesys_lock();
     off_t file_ofs;
     bool success = false;
     int i;
 
-    /* Allocate and activate page directory. */
+    /* Allocate the supplemental page table, then allocate and
+     activate the page directory. */
+    if (!spt_create())
+        goto done;
     t->pagedir = pagedir_create();
     if (t->pagedir == NULL)
+    {
+        hash_destroy(&t->spt, NULL);
         goto done;
+    }
     process_activate();
 
     /* Open executable file. */
-    lock_acquire(filesys_lock);
+    rwlock_acquire_write(filesys_lock);
     file = filesys_open(file_name);
     if (file == NULL)
     {
@@ -447,7 +443,7 @@ bool load(const char *file_name, void (**eip)(void), void **esp)
 
 done:
     /* We arrive here whether the load is successful or not. */
-    lock_release(filesys_lock);
+    rwlock_release_write(filesys_lock);
     return success;
 }
 
@@ -531,7 +527,7 @@ load_segment(struct file *file, off_t ofs, uint8_t *upage,
         size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
         size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
-        struct spte* page = malloc(sizeof(struct spte));
+        struct spte* page = spte_alloc();
         if(page==NULL)
             return false;
         page->thread_id = thread_tid();
@@ -542,7 +538,7 @@ load_segment(struct file *file, off_t ofs, uint8_t *upage,
         page->writable = writable;
         page->page_number = upage;
         page->is_pinned = false;
-        list_push_back(&thread_current()->spt, &page->spt_elem);
+        spt_insert(page);
 
 
         // /* Get a page of memory. */
@@ -590,7 +586,7 @@ setup_stack(void **esp)
     {
         success = install_page(((uint8_t *)PHYS_BASE) - PGSIZE, frame->frame_number, true);
         if (success){
-            struct spte* page = malloc(sizeof(struct spte));
+            struct spte* page = spte_alloc();
             frame->mapped_page = page;
             if(page==NULL)
                 return false;
@@ -603,7 +599,7 @@ setup_stack(void **esp)
             page->frame_number = frame->frame_number;
                     page->is_pinned = false;
 
-            list_push_back(&thread_current()->spt, &page->spt_elem);
+            spt_insert(page);
             *esp = PHYS_BASE;
             
 
@@ -6,6 +6,7 @@
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "lib/kernel/stdio.h"
+#include "threads/cpugroup.h"
 #include "threads/interrupt.h"
 #include "threads/palloc.h"
 #include "threads/synch.h"
@@ -16,9 +17,10 @@
 #include "vm/page.h"
 #include "vm/frame.h"
 #include "vm/mmap.h"
+#include "vm/swap.h"
 #include "devices/timer.h"
 
-struct lock filesys_lock;
+struct rwlock filesys_lock;
 
 static void syscall_handler(struct intr_frame *);
 
@@ -36,12 +38,15 @@ static int syscall_write(int, const void *, unsigned);
 static void syscall_seek(int, unsigned);
 static unsigned syscall_tell(int);
 static int syscall_mmap(int fd, void *addr);
+static bool syscall_sched_deadline(int, int);
+static int syscall_sched_wait_period(void);
+static bool syscall_cpu_limit(int, int);
 
 /* Registers the system call interrupt handler. */
 void syscall_init(void)
 {
     intr_register_int(0x30, 3, INTR_ON, syscall_handler, "syscall");
-    lock_init(&filesys_lock);
+    rwlock_init(&filesys_lock);
 }
 
 /* Pops the system call number and handles system call
@@ -229,6 +234,35 @@ syscall_handler(struct intr_frame *f)
         syscall_munmap(mapid);
         break;
     }
+    case SYS_SCHED_DEADLINE:
+    {
+        int runtime, period;
+
+        check_vaddr(esp + sizeof(uintptr_t));
+        check_vaddr(esp + 3 * sizeof(uintptr_t) - 1);
+        runtime = *(int *)(esp + sizeof(uintptr_t));
+        period = *(int *)(esp + 2 * sizeof(uintptr_t));
+
+        f->eax = (uint32_t)syscall_sched_deadline(runtime, period);
+        break;
+    }
+    case SYS_SCHED_WAIT_PERIOD:
+    {
+        f->eax = (uint32_t)syscall_sched_wait_period();
+        break;
+    }
+    case SYS_CPU_LIMIT:
+    {
+        int quota, period;
+
+        check_vaddr(esp + sizeof(uintptr_t));
+        check_vaddr(esp + 3 * sizeof(uintptr_t) - 1);
+        quota = *(int *)(esp + sizeof(uintptr_t));
+        period = *(int *)(esp + 2 * sizeof(uintptr_t));
+
+        f->eax = (uint32_t)syscall_cpu_limit(quota, period);
+        break;
+    }
     default:
         syscall_exit(-1);
     }
@@ -244,7 +278,7 @@ check_vaddr(const void *vaddr)
         syscall_exit(-1);
 }
 
-struct lock *syscall_get_filesys_lock(void)
+struct rwlock *syscall_get_filesys_lock(void)
 {
     return &filesys_lock;
 }
@@ -296,21 +330,16 @@ static bool syscall_create(const char *file, unsigned initial_size)
 {
     bool success;
     int i;
-<<<<<<< Updated upstream
 
-=======
-    if(!lock_held_by_current_thread(&filesys_lock))
-        lock_acquire(&filesys_lock);
->>>>>>> Stashed changes
     check_vaddr(file);
     for (i = 0; *(file + i); i++)
         check_vaddr(file + i + 1);
     timer_sleep(50);
     // if(!lock_held_by_current_thread(&filesys_lock))
-    lock_acquire(&filesys_lock);
+    rwlock_acquire_write(&filesys_lock);
     // printf("tid %p\n", thread_tid());
     success = filesys_create(file, (off_t)initial_size);
-    lock_release(&filesys_lock);
+    rwlock_release_write(&filesys_lock);
 
     return success;
 }
@@ -325,9 +354,9 @@ static bool syscall_remove(const char *file)
     for (i = 0; *(file + i); i++)
         check_vaddr(file + i + 1);
 
-    lock_acquire(&filesys_lock);
+    rwlock_acquire_write(&filesys_lock);
     success = filesys_remove(file);
-    lock_release(&filesys_lock);
+    rwlock_release_write(&filesys_lock);
 
     return success;
 }
@@ -346,14 +375,14 @@ static int syscall_open(const char *file)
     fde = palloc_get_page(0);
     if (!fde)
         return -1;
-        lock_acquire(&filesys_lock);
+    rwlock_acquire_write(&filesys_lock);
     timer_sleep(50);
 
     new_file = filesys_open(file);
     if (!new_file)
     {
         palloc_free_page(fde);
-        lock_release(&filesys_lock);
+        rwlock_release_write(&filesys_lock);
 
         return -1;
     }
@@ -361,7 +390,7 @@ static int syscall_open(const char *file)
     fde->fd = thread_get_next_fd();
     fde->file = new_file;
     list_push_back(thread_get_fdt(), &fde->fdtelem);
-    lock_release(&filesys_lock);
+    rwlock_release_write(&filesys_lock);
 
     return fde->fd;
 }
@@ -375,9 +404,9 @@ static int syscall_filesize(int fd)
     if (!fde)
         return -1;
 
-    lock_acquire(&filesys_lock);
+    rwlock_acquire_read(&filesys_lock);
     filesize = file_length(fde->file);
-    lock_release(&filesys_lock);
+    rwlock_release_read(&filesys_lock);
 
     return filesize;
 }
@@ -387,20 +416,19 @@ static int syscall_read(int fd, void *buffer, unsigned size)
 {
 
     struct file_descriptor_entry *fde;
-    int bytes_read, i;
-    for (i = 0; i < size; i++){
+    int bytes_read;
+    unsigned i;
+    /* Every page the buffer touches must be mapped and writable.
+       Checks the first byte and then one byte per page. */
+    for (i = 0; i < size; i = pg_round_down(buffer + i) + PGSIZE - buffer){
+        struct spte* page;
         if(buffer+i==NULL||!is_user_vaddr(buffer+i)){
             syscall_exit(-1);
         }
-        if(find_page(buffer+i)==NULL){
+        page = find_page(buffer+i);
+        if(page==NULL||!page->writable){
             syscall_exit(-1);
-        }else{
-            if(!find_page(buffer+i)->writable){
-                syscall_exit(-1);
-            }
         }
-
-        
     }
     
     if (fd == 0)
@@ -417,9 +445,12 @@ static int syscall_read(int fd, void *buffer, unsigned size)
     if (!fde)
         return -1;
 
-    lock_acquire(&filesys_lock);
+    /* Exclusive, like write: file_read() moves the file's
+       position, and the file system below has not been made safe
+       for concurrent reads. */
+    rwlock_acquire_write(&filesys_lock);
     bytes_read = (int)file_read(fde->file, buffer, (off_t)size);
-    lock_release(&filesys_lock);
+    rwlock_release_write(&filesys_lock);
     return bytes_read;
 }
 
@@ -443,9 +474,9 @@ static int syscall_write(int fd, const void *buffer, unsigned size)
     if (!fde)
         return -1;
 
-    lock_acquire(&filesys_lock);
+    rwlock_acquire_write(&filesys_lock);
     bytes_written = (int)file_write(fde->file, buffer, (off_t)size);
-    lock_release(&filesys_lock);
+    rwlock_release_write(&filesys_lock);
 
     return bytes_written;
 }
@@ -458,9 +489,9 @@ static void syscall_seek(int fd, unsigned position)
     if (!fde)
         return;
 
-    lock_acquire(&filesys_lock);
+    rwlock_acquire_write(&filesys_lock);
     file_seek(fde->file, (off_t)position);
-    lock_release(&filesys_lock);
+    rwlock_release_write(&filesys_lock);
 }
 
 /* Handles tell() system call. */
@@ -472,13 +503,53 @@ static unsigned syscall_tell(int fd)
     if (!fde)
         return -1;
 
-    lock_acquire(&filesys_lock);
+    rwlock_acquire_read(&filesys_lock);
     pos = (unsigned)file_tell(fde->file);
-    lock_release(&filesys_lock);
+    rwlock_release_read(&filesys_lock);
 
     return pos;
 }
 
+/* Handles sched_deadline() system call. */
+static bool syscall_sched_deadline(int runtime, int period)
+{
+    return thread_set_deadline(runtime, period);
+}
+
+/* Handles sched_wait_period() system call.  Returns the number of
+   deadlines missed so far, or -1 if the process is not in the
+   deadline class. */
+static int syscall_sched_wait_period(void)
+{
+    if (thread_current()->dl_period == 0)
+        return -1;
+    thread_deadline_wait();
+    return (int)thread_get_deadline_misses();
+}
+
+/* Handles cpu_limit() system call.  Moves the process into a new
+   CPU group whose threads may run for QUOTA timer ticks in every
+   PERIOD ticks; the processes it starts from then on join the
+   group too.  A process that is already in a group may only
+   tighten its share, so that it cannot escape a limit that its
+   parent set. */
+static bool syscall_cpu_limit(int quota, int period)
+{
+    struct thread *cur = thread_current();
+    struct cpu_group *g = cur->cpu_group;
+
+    if (quota <= 0 || period <= 0 || quota > period)
+        return false;
+    if (g != NULL && (int64_t)quota * g->period > g->quota * period)
+        return false;
+
+    g = cpu_group_create(quota, period);
+    if (g == NULL)
+        return false;
+    cpu_group_attach(cur, g);
+    return true;
+}
+
 /* Handles close() system call. */
 void syscall_close(int fd)
 {
@@ -487,11 +558,11 @@ void syscall_close(int fd)
     if (!fde)
         return;
 
-    lock_acquire(&filesys_lock);
+    rwlock_acquire_write(&filesys_lock);
     file_close(fde->file);
     list_remove(&fde->fdtelem);
     palloc_free_page(fde);
-    lock_release(&filesys_lock);
+    rwlock_release_write(&filesys_lock);
 }
 
 static int syscall_mmap(int fd, void *addr){
@@ -502,18 +573,18 @@ static int syscall_mmap(int fd, void *addr){
     // upage is muliple of PGSIZE
     if(!addr || !is_user_vaddr(addr))
         return -1;
-    lock_acquire(&filesys_lock);
+    rwlock_acquire_write(&filesys_lock);
 
     struct file_descriptor_entry *fde = process_get_fde(fd);
     if(fde==NULL){
-        lock_release(&filesys_lock);
+        rwlock_release_write(&filesys_lock);
         return -1;
     }
     int page_num;
     int read_bytes = file_length(fde->file);
     int ofs = 0;
     if(read_bytes==0){
-        lock_release(&filesys_lock);
+        rwlock_release_write(&filesys_lock);
         return -1;
     }
     if(read_bytes % PGSIZE == 0){
@@ -525,19 +596,19 @@ static int syscall_mmap(int fd, void *addr){
 
     for(int i = 0; i < page_num; i++){
         if(find_page((uint8_t*)addr + i * PGSIZE)!=NULL){
-            lock_release(&filesys_lock);
+            rwlock_release_write(&filesys_lock);
             return -1;
         }
     } 
-    struct spte* start_page;
+    struct spte* start_page = NULL;
     for(int i=0; i < page_num; i++){
         int page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
         int page_zero_bytes = PGSIZE - page_read_bytes;
 
-        struct spte* page = malloc(sizeof(struct spte));
+        struct spte* page = spte_alloc();
         if(page==NULL){
             // munmap
-            lock_release(&filesys_lock);
+            rwlock_release_write(&filesys_lock);
             return -1;
         }
         if(i==0){
@@ -550,7 +621,7 @@ static int syscall_mmap(int fd, void *addr){
         page->zero_bytes = page_zero_bytes;
         page->writable = true;
         page->page_number = addr;
-        list_push_back(&thread_current()->spt, &page->spt_elem);
+        spt_insert(page);
 
         read_bytes -= page_read_bytes;
         addr += PGSIZE;
@@ -559,10 +630,10 @@ static int syscall_mmap(int fd, void *addr){
     int mapid = add_mmap_file(start_page);
     if(mapid==-1){
         // munmap
-        lock_release(&filesys_lock);
+        rwlock_release_write(&filesys_lock);
         return -1;
     }
-    lock_release(&filesys_lock);
+    rwlock_release_write(&filesys_lock);
     return mapid;
 } 
 
@@ -571,23 +642,21 @@ void syscall_munmap(mapid_t mapid){
     struct mmap_file* mmap_file = find_mmap_file(mapid);
     if(mmap_file==NULL)
         return;
-    struct spte* cur_stpe = mmap_file->spte;
-    struct spte* next_stpe;
+    uint8_t* addr = mmap_file->spte->page_number;
     struct thread* cur = thread_current();
-    for(int i=0; i < mmap_file->page_num; i++){
+    for(int i=0; i < mmap_file->page_num; i++, addr += PGSIZE){
+        struct spte* cur_stpe = find_page(addr);
+        frame_wait_evicted(cur_stpe);
         file_seek(cur_stpe->related_file, cur_stpe->offset);
-        if(&cur_stpe->spt_elem != list_tail(&cur->spt)){
-            next_stpe = list_entry(list_next(&cur_stpe->spt_elem), struct spte, spt_elem);
-        }
-
-        if(pagedir_is_dirty(cur->pagedir, cur_stpe->page_number)){
+        if(cur_stpe->frame_number != NULL
+           && pagedir_is_dirty(cur->pagedir, cur_stpe->page_number)){
             file_write(cur_stpe->related_file, cur_stpe->frame_number, cur_stpe->read_bytes);
         }
-        list_remove(&cur_stpe->spt_elem);
+        spt_remove(cur_stpe);
         pagedir_clear_page(cur->pagedir, cur_stpe->page_number);
-        deallocate_frame(cur_stpe->frame_number);
-        free(cur_stpe);
-        cur_stpe = next_stpe;
+        release_frame(cur_stpe);
+        swap_free(cur_stpe);
+        spte_free(cur_stpe);
     }
-    list_remove(&mmap_file->mmap_elem);
+    remove_mmap_file(mmap_file);
 }
\ No newline at end of file
@@ -5,7 +5,7 @@
 
 void syscall_init(void);
 
-struct lock *syscall_get_filesys_lock(void);
+struct rwlock *syscall_get_filesys_lock(void);
 
 void syscall_exit(int);
 void syscall_close(int);
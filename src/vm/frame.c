@@ -1,133 +1,307 @@
 #include "vm/frame.h"
+#include <bitmap.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/loader.h"
 #include "threads/palloc.h"
-#include "threads/malloc.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
 #include "vm/frame.h"
+#include "vm/swap.h"
 #include "threads/synch.h"
+#include "devices/timer.h"
 
-struct list frame_table;
-extern struct list* pall_list;
-struct frame_table_entry* clock_pointer;
-struct lock frame_table_lock;
+/* Frame table, with one entry per physical page.  User pages
+   normally come from the user pool, but the kernel pool may lend
+   pages to it, so the table covers all of RAM. */
+static struct frame_table_entry* frame_table;
+static struct bitmap* frame_used;   /* Entries in use. */
+static size_t clock_hand;           /* Next entry the clock examines. */
+struct rwlock frame_table_lock;
+
+/* evict() writes pages out without the frame table lock, and
+   signals evict_done under evict_lock when it clears the pages'
+   evicting flags afterward. */
+static struct lock evict_lock;
+static struct condition evict_done;
+
+/* Statistics. */
+static long long evict_cnt;         /* Frames evicted. */
+static int64_t evict_ns;            /* Time spent evicting. */
 
 void frame_table_init(){
-	list_init(&frame_table);
-	lock_init(&frame_table_lock);
+	size_t pages = DIV_ROUND_UP(init_ram_pages * sizeof *frame_table, PGSIZE);
+	frame_table = palloc_get_multiple(PAL_ASSERT | PAL_ZERO, pages);
+	frame_used = bitmap_create(init_ram_pages);
+	if(frame_used == NULL)
+		PANIC("frame table: out of memory");
+	rwlock_init(&frame_table_lock);
+	lock_init(&evict_lock);
+	cond_init(&evict_done);
+}
+
+/* Returns the index of KPAGE's entry in the frame table, or
+   BITMAP_ERROR if KPAGE is not a page of RAM. */
+static size_t frame_index(uint8_t *kpage){
+	size_t idx;
+	if(kpage == NULL || !is_kernel_vaddr(kpage))
+		return BITMAP_ERROR;
+	idx = vtop(kpage) >> PGBITS;
+	return idx < init_ram_pages ? idx : BITMAP_ERROR;
+}
+
+/* Returns the frame table entry for KPAGE, or a null pointer if
+   KPAGE is not in use as a frame. */
+struct frame_table_entry* frame_lookup(uint8_t *kpage){
+	size_t idx = frame_index(kpage);
+	if(idx == BITMAP_ERROR || !bitmap_test(frame_used, idx))
+		return NULL;
+	return &frame_table[idx];
+}
+
+/* Claims the frame table entry for KPAGE. */
+static struct frame_table_entry* claim_frame(uint8_t *kpage){
+	size_t idx = frame_index(kpage);
+	struct frame_table_entry* frame = &frame_table[idx];
+	ASSERT(idx != BITMAP_ERROR);
+	frame->frame_number = kpage;
+	frame->mapped_page = NULL;
+	frame->accessed_bit = 1;
+	frame->pinned = false;
+	bitmap_mark(frame_used, idx);
+	return frame;
+}
+
+/* Acquires the frame table lock for writing, unless the current
+   thread already holds it.  Returns true if it was acquired, in
+   which case the caller must release it with unlock_frame_table(). */
+static bool lock_frame_table(void){
+	if(rwlock_held_by_current_thread(&frame_table_lock))
+		return false;
+	rwlock_acquire_write(&frame_table_lock);
+	return true;
+}
+
+static void unlock_frame_table(bool locked){
+	if(locked)
+		rwlock_release_write(&frame_table_lock);
 }
 
 struct frame_table_entry* allocate_frame(enum palloc_flags flag){
-	if(!lock_held_by_current_thread(&frame_table_lock)){
-		lock_acquire(&frame_table_lock);	
-	}
+	bool locked = lock_frame_table();
 	uint8_t *kpage = palloc_get_page(flag);
-	struct frame_table_entry* frame;
-	if(kpage!=NULL){
-		frame = malloc(sizeof(struct frame_table_entry));
-		frame->frame_number = kpage;
-		frame->accessed_bit = 1;
-
-		list_push_back(&frame_table, &frame->frame_elem);
-	}
-	else{
-		evict();
-		uint8_t *kpage = palloc_get_page(flag);
-		frame = malloc(sizeof(struct frame_table_entry));
-		frame->frame_number = kpage;
-		frame->accessed_bit = 1;
-
-		list_push_back(&frame_table, &frame->frame_elem);
-	}
-	if(lock_held_by_current_thread(&frame_table_lock))
-		lock_release(&frame_table_lock);
+	struct frame_table_entry* frame = NULL;
+	if(kpage==NULL && evict(locked))
+		kpage = palloc_get_page(flag);
+	if(kpage!=NULL)
+		frame = claim_frame(kpage);
+	unlock_frame_table(locked);
 	return frame; 
 }
 
+/* Like allocate_frame(), but returns a null pointer instead of
+   evicting when no page is free. */
+struct frame_table_entry* try_allocate_frame(enum palloc_flags flag){
+	bool locked = lock_frame_table();
+	uint8_t *kpage = palloc_get_page(flag);
+	struct frame_table_entry* frame = NULL;
+	if(kpage!=NULL)
+		frame = claim_frame(kpage);
+	unlock_frame_table(locked);
+	return frame;
+}
+
+/* Records that FRAME holds PAGE. */
+void map_frame(struct frame_table_entry* frame, struct spte* page){
+	bool locked = lock_frame_table();
+	page->frame_number = frame->frame_number;
+	frame->mapped_page = page;
+	unlock_frame_table(locked);
+}
+
+/* Removes FRAME from the frame table and frees its page. */
+static void free_frame(struct frame_table_entry* frame){
+	uint8_t *kpage = frame->frame_number;
+	frame->frame_number = NULL;
+	frame->mapped_page = NULL;
+	frame->pinned = false;
+	bitmap_reset(frame_used, frame - frame_table);
+	palloc_free_page(kpage);
+}
+
 void deallocate_frame(uint8_t *kpage){
-	if(!lock_held_by_current_thread(&frame_table_lock)){
-		lock_acquire(&frame_table_lock);	
-	}
-	struct list_elem* e;
-	for(e = list_begin(&frame_table); e != list_end(&frame_table); e = list_next(e)){
-		struct frame_table_entry *target = list_entry (e, struct frame_table_entry, frame_elem);
-		if(target->frame_number == kpage){
-			list_remove(e);
-			palloc_free_page(kpage);
-			break;		
-		}
-	}
-	if(lock_held_by_current_thread(&frame_table_lock))
-		lock_release(&frame_table_lock);
-}
-
-struct thread* find_thread(int tid){
-	struct list_elem* e;
-	struct thread* thread;
-	for(e = list_begin(pall_list); e != list_end(pall_list); e = list_next(e)){
-		thread = list_entry(e, struct thread, allelem);
-		if(thread->tid == tid){
-			return thread;
-		}
+	bool locked = lock_frame_table();
+	struct frame_table_entry* frame = frame_lookup(kpage);
+	if(frame != NULL)
+		free_frame(frame);
+	unlock_frame_table(locked);
+}
+
+/* Frees the frame that holds PAGE, if PAGE is resident.  Unlike
+   deallocate_frame(), checks under the frame table lock that the
+   frame still belongs to PAGE, so a frame that was evicted and
+   reused by another process is left alone. */
+void release_frame(struct spte* page){
+	bool locked = lock_frame_table();
+	struct frame_table_entry* frame = frame_lookup(page->frame_number);
+	if(frame != NULL && frame->mapped_page == page)
+		free_frame(frame);
+	page->frame_number = NULL;
+	unlock_frame_table(locked);
+}
+
+/* Waits until evict() has finished writing out PAGE, if it is
+   doing so.  Must be called before PAGE is faulted back in or
+   freed, since evict() still uses PAGE and its frame. */
+void frame_wait_evicted(struct spte* page){
+	lock_acquire(&evict_lock);
+	while(page->evicting)
+		cond_wait(&evict_done, &evict_lock);
+	lock_release(&evict_lock);
+}
+
+/* Advances the clock hand to the next frame in use and returns
+   that frame. */
+static struct frame_table_entry* clock_next(void){
+	size_t idx = bitmap_scan(frame_used, clock_hand, 1, true);
+	if(idx == BITMAP_ERROR)
+		idx = bitmap_scan(frame_used, 0, 1, true);
+	ASSERT(idx != BITMAP_ERROR);
+	clock_hand = idx + 1;
+	return &frame_table[idx];
+}
+
+/* Chooses a frame to evict by the clock algorithm.  Each frame
+   leads straight to its page and the page to its owner's page
+   directory, so no thread list is searched.  Two sweeps of the
+   clock are enough to find a frame unless all of them are still
+   being set up, in which case returns a null pointer.  The caller
+   must hold the frame table lock. */
+struct frame_table_entry* select_victim(void){
+	size_t sweep = 2 * bitmap_count(frame_used, 0, init_ram_pages, true);
+	ASSERT(rwlock_held_by_current_thread(&frame_table_lock));
+	while(sweep-- > 0){
+		struct frame_table_entry* frame = clock_next();
+		struct spte* page = frame->mapped_page;
+		/* Skip frames that are still being set up or are being
+		   written out. */
+		if(page == NULL || frame->pinned)
+			continue;
+		if(!pagedir_is_accessed(page->pagedir, page->page_number))
+			return frame;
+		pagedir_set_accessed(page->pagedir, page->page_number, false);
 	}
 	return NULL;
 }
 
-struct frame_table_entry* select_victim(){
-	struct thread* target;
+/* Returns the frame holding the page at UPAGE in page directory
+   PD if that page may join a swap-out cluster: it is resident,
+   set up, not recently accessed, and must be written to swap. */
+static struct frame_table_entry* cluster_candidate(uint32_t* pd, uint8_t* upage){
 	struct frame_table_entry* frame;
-	struct list_elem* e;
-/*	return list_entry(list_begin(&frame_table), struct frame_table_entry, frame_elem);
-*/	if(!lock_held_by_current_thread(&frame_table_lock)){
-		lock_acquire(&frame_table_lock);	
-	}
-	if(clock_pointer==NULL){
-		clock_pointer = list_entry(list_begin(&frame_table), struct frame_table_entry, frame_elem);
-	}
-	target = find_thread(clock_pointer->mapped_page->thread_id);
-
-	while(pagedir_is_accessed(target->pagedir, clock_pointer->mapped_page->page_number)
-	 // && (clock_pointer->accessed_bit == 1)
-	 ){
-		pagedir_set_accessed(target->pagedir, clock_pointer->mapped_page->page_number, false);
-		// clock_pointer->accessed_bit = 0;
-		if(clock_pointer == list_entry(list_rbegin(&frame_table), struct frame_table_entry, frame_elem)){
-			clock_pointer = list_entry(list_begin(&frame_table), struct frame_table_entry, frame_elem);
-		}
-		else {
-			clock_pointer = list_entry(list_next(&clock_pointer->frame_elem), struct frame_table_entry, frame_elem);
-		}
-		target = find_thread(clock_pointer->mapped_page->thread_id);
+	if(!is_user_vaddr(upage) || upage < (uint8_t*) PGSIZE)
+		return NULL;
+	frame = frame_lookup(pagedir_get_page(pd, upage));
+	if(frame == NULL || frame->mapped_page == NULL || frame->pinned
+	   || frame->mapped_page->pagedir != pd
+	   || pagedir_is_accessed(pd, upage) || !is_swap(frame))
+		return NULL;
+	return frame;
+}
+
+/* Fills CLUSTER with VICTIM and the frames holding the pages
+   next to it in the same address space that can be written out
+   with it, in order of virtual address.  Returns the number of
+   frames, at most SWAP_CLUSTER_MAX. */
+static size_t gather_cluster(struct frame_table_entry* victim,
+                             struct frame_table_entry** cluster){
+	struct spte* page = victim->mapped_page;
+	uint8_t* first = page->page_number;
+	uint8_t* last = page->page_number;
+	size_t cnt = 1;
+	size_t i;
+
+	/* Find how far the run extends below and above VICTIM. */
+	while(cnt < SWAP_CLUSTER_MAX
+	      && cluster_candidate(page->pagedir, first - PGSIZE) != NULL){
+		first -= PGSIZE;
+		cnt++;
 	}
-	if(&clock_pointer->frame_elem == list_rbegin(&frame_table)){
-		clock_pointer = list_entry(list_begin(&frame_table), struct frame_table_entry, frame_elem);
-		if(lock_held_by_current_thread(&frame_table_lock))
-			lock_release(&frame_table_lock);
-		return list_entry(list_rbegin(&frame_table), struct frame_table_entry, frame_elem);
+	while(cnt < SWAP_CLUSTER_MAX
+	      && cluster_candidate(page->pagedir, last + PGSIZE) != NULL){
+		last += PGSIZE;
+		cnt++;
 	}
-	else {
-		clock_pointer = list_entry(list_next(&clock_pointer->frame_elem), struct frame_table_entry, frame_elem);
-		if(lock_held_by_current_thread(&frame_table_lock))
-			lock_release(&frame_table_lock);
-		return list_entry(list_prev(&clock_pointer->frame_elem), struct frame_table_entry, frame_elem);
+	for(i = 0; i < cnt; i++){
+		uint8_t* upage = first + i * PGSIZE;
+		cluster[i] = upage == page->page_number
+		             ? victim : cluster_candidate(page->pagedir, upage);
 	}
-	// if(lock_held_by_current_thread(&frame_table_lock))
-	//	lock_release(&frame_table_lock);
+	return cnt;
 }
 
+/* Evicts a frame.  If its page must be written to swap, the
+   dirty pages next to it in the same address space are evicted
+   along with it, so that the cluster goes to contiguous swap
+   slots in one request.  Returns false if there is no frame to
+   evict.
 
-
-void evict() {
+   The caller must hold the frame table lock.  If UNLOCK is true,
+   the lock is dropped during the write: the frames are pinned so
+   that no one else evicts or frees them meanwhile, and their
+   pages are flagged as evicting so that a fault on one or its
+   release waits in frame_wait_evicted() until it is in swap.
+   Callers that took the lock further up must pass false, so that
+   their critical section is not broken. */
+bool evict(bool unlock) {
+	int64_t start = timer_ns();
 	struct frame_table_entry* victim = select_victim();
-	// printf("evcit:%d\n", victim->mapped_page->thread_id);
-	struct thread* thread = find_thread(victim->mapped_page->thread_id);	
-	if(is_swap(victim) == 0){
-		pagedir_clear_page(thread->pagedir, victim->mapped_page->page_number);
-		deallocate_frame(victim->frame_number);
+	struct frame_table_entry* cluster[SWAP_CLUSTER_MAX];
+	bool to_swap;
+	size_t cnt = 1;
+	size_t i;
+
+	if(victim == NULL)
+		return false;
+	to_swap = is_swap(victim);
+
+	cluster[0] = victim;
+	if(to_swap)
+		cnt = gather_cluster(victim, cluster);
+
+	/* Flag the pages before unmapping them, so that a fault on
+	   one of them finds it flagged. */
+	for(i = 0; i < cnt; i++){
+		struct spte* page = cluster[i]->mapped_page;
+		page->evicting = true;
+		cluster[i]->pinned = true;
+		pagedir_clear_page(page->pagedir, page->page_number);
 	}
-	else{
-		// swap
-		swap_write(victim->mapped_page->page_number, victim->frame_number);
-		pagedir_clear_page(thread->pagedir, victim->mapped_page->page_number);
-		deallocate_frame(victim->frame_number);
+	if(to_swap){
+		if(unlock)
+			rwlock_release_write(&frame_table_lock);
+		swap_write(cluster, cnt);
+		if(unlock)
+			rwlock_acquire_write(&frame_table_lock);
 	}
 
+	lock_acquire(&evict_lock);
+	for(i = 0; i < cnt; i++){
+		struct spte* page = cluster[i]->mapped_page;
+		free_frame(cluster[i]);
+		page->frame_number = NULL;
+		page->evicting = false;
+	}
+	cond_broadcast(&evict_done, &evict_lock);
+	lock_release(&evict_lock);
+	evict_cnt += cnt;
+	evict_ns += timer_ns() - start;
+	return true;
 }
 
+void frame_print_stats(void){
+	printf("Frames: %zu in use, %lld evicted, %lld us per eviction\n",
+	       bitmap_count(frame_used, 0, init_ram_pages, true), evict_cnt,
+	       evict_cnt > 0 ? evict_ns / 1000 / evict_cnt : 0);
+}
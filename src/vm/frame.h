@@ -3,20 +3,30 @@
 #include <inttypes.h>
 #include <list.h>
 #include "threads/palloc.h"
+#include "threads/synch.h"
 #include "vm/page.h"
 
+/* One entry per physical page of RAM, indexed by physical page
+   number.  An entry is in use while FRAME_NUMBER is nonnull. */
 struct frame_table_entry {
 	uint8_t * frame_number;
-	struct list_elem frame_elem;
 	struct spte* mapped_page;
 	int accessed_bit;
+	bool pinned;                 /* Being written out by evict()? */
 };
 
+extern struct rwlock frame_table_lock;
+
 void frame_table_init(void);
 struct frame_table_entry* allocate_frame(enum palloc_flags flag);
+struct frame_table_entry* try_allocate_frame(enum palloc_flags flag);
+void map_frame(struct frame_table_entry* frame, struct spte* page);
 void deallocate_frame(uint8_t *kpage);
-struct thread* find_thread(int tid);
-struct frame_table_entry* select_victim();
-void evict();
+struct frame_table_entry* frame_lookup(uint8_t *kpage);
+void release_frame(struct spte* page);
+void frame_wait_evicted(struct spte* page);
+struct frame_table_entry* select_victim(void);
+bool evict(bool unlock);
+void frame_print_stats(void);
 
 #endif /* vm/frame.h */
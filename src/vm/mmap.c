@@ -1,20 +1,28 @@
 #include "vm/mmap.h"
 #include "threads/thread.h"
-#include "threads/malloc.h"
+#include "threads/slab.h"
 #include "threads/vaddr.h"
 #include "userprog/syscall.h"
 #include "userprog/pagedir.h"
 
+static struct slab_cache mmap_file_cache;
+
+void mmap_init(void){
+	slab_cache_init(&mmap_file_cache, "mmap_file", sizeof(struct mmap_file), 0, NULL);
+}
+
 int add_mmap_file(struct spte* spte){
 	int read_bytes = file_length(spte->related_file);
-	struct mmap_file* mmap_file = malloc(sizeof(struct mmap_file));
+	struct mmap_file* mmap_file = slab_alloc(&mmap_file_cache);
 	struct thread* cur = thread_current();
 
 	int page_num;
 	if(mmap_file==NULL)
 		return -1;
-	if(read_bytes==0)
+	if(read_bytes==0){
+		slab_free(&mmap_file_cache, mmap_file);
 		return -1;
+	}
 	if(read_bytes % PGSIZE == 0){
         page_num = read_bytes / PGSIZE;
 	}
@@ -38,6 +46,11 @@ int add_mmap_file(struct spte* spte){
 	return i;
 }
 
+void remove_mmap_file(struct mmap_file* mmap_file){
+	list_remove(&mmap_file->mmap_elem);
+	slab_free(&mmap_file_cache, mmap_file);
+}
+
 struct mmap_file* find_mmap_file(int mapid){
     struct list_elem* e;
     struct thread* cur = thread_current();
@@ -51,11 +64,12 @@ struct mmap_file* find_mmap_file(int mapid){
     return NULL;
 } 
 
-void clear_mmap_file_list(){
+void clear_mmap_file_list(void){
 	struct thread* cur = thread_current();
 	struct list_elem* e;
-	for(e = list_begin(&cur->mmap_file_list); e != list_end(&cur->mmap_file_list); e = list_next(e)){
+	for(e = list_begin(&cur->mmap_file_list); e != list_end(&cur->mmap_file_list); ){
 		struct mmap_file *target = list_entry (e, struct mmap_file, mmap_elem);
+		e = list_next(e);
 		syscall_munmap(target->map_id);
 	}
 }
@@ -13,6 +13,9 @@ struct mmap_file {
 	struct spte* spte;
 };
 
+void mmap_init(void);
 int add_mmap_file(struct spte* spte);
+void remove_mmap_file(struct mmap_file* mmap_file);
 struct mmap_file* find_mmap_file(int mapid);
+void clear_mmap_file_list(void);
 #endif /* vm/mmap.h */
@@ -1,62 +1,101 @@
 #include "vm/page.h"
+#include <string.h>
+#include "userprog/pagedir.h"
 #include "threads/vaddr.h"
 #include "threads/thread.h"
 #include "vm/frame.h"
+#include "vm/swap.h"
 #include "threads/synch.h"
+#include "threads/slab.h"
 
-extern frame_table_lock;
-extern frame_table;
-extern pall_list;
+static struct slab_cache spte_cache;
 
-struct spte* find_page(uint8_t* number){
-	struct list_elem* e;
-	struct thread* cur = thread_current();
-	for(e = list_begin(&cur->spt); e != list_end(&cur->spt); e = list_next(e)){
-		struct spte *target = list_entry (e, struct spte, spt_elem);
-		if(target->page_number == pg_round_down(number)){
-			return target;		
-		}
-	}
-	return NULL;
+void spt_init(void){
+	slab_cache_init(&spte_cache, "spte", sizeof(struct spte), 0, NULL);
 }
 
-struct spte* find_page_from_frame(uint8_t* number){
-	struct list_elem* e;
-	for(e = list_begin(&frame_table); e != list_end(&frame_table); e = list_next(e)){
-		struct frame_table_entry *target = list_entry(e, struct frame_table_entry, frame_elem);
-		if(target->mapped_page->page_number == pg_round_down(number)){
-			return target->mapped_page;		
-		}
-	}
-	return NULL;
-} 
-
-struct spte* find_page_from_spts(uint8_t* number){
-	struct list_elem* e;
-	struct list_elem* e2;
-	for(e = list_begin(pall_list); e != list_end(pall_list); e = list_next(e)){
-		struct thread* target = list_entry(e, struct thread, allelem);
-		for(e2 = list_begin(&target->spt); e2 != list_end(&target->spt); e2 = list_next(e2)){
-			struct spte *spte = list_entry (e2, struct spte, spt_elem);
-			if(spte->page_number == pg_round_down(number)){
-				return spte;		
-			}
-		}
+/* Returns a new, zeroed page table entry owned by the current
+   process, or a null pointer if memory is not available. */
+struct spte* spte_alloc(void){
+	struct spte* spte = slab_alloc(&spte_cache);
+	if(spte != NULL){
+		memset(spte, 0, sizeof *spte);
+		spte->pagedir = thread_current()->pagedir;
+		spte->swap_slot = SWAP_SLOT_NONE;
 	}
-	return NULL;
+	return spte;
+}
+
+void spte_free(struct spte* spte){
+	slab_free(&spte_cache, spte);
+}
 
+static unsigned spte_hash(const struct hash_elem *e, void *aux UNUSED){
+	const struct spte *spte = hash_entry(e, struct spte, spt_elem);
+	return hash_int((uintptr_t) spte->page_number >> PGBITS);
 }
 
+static bool spte_less(const struct hash_elem *a, const struct hash_elem *b,
+                      void *aux UNUSED){
+	return hash_entry(a, struct spte, spt_elem)->page_number
+	       < hash_entry(b, struct spte, spt_elem)->page_number;
+}
 
+/* Initializes the current thread's supplemental page table.
+   Returns false if memory is not available. */
+bool spt_create(void){
+	return hash_init(&thread_current()->spt, spte_hash, spte_less, NULL);
+}
 
-void clear_spt(){
-	struct thread* cur= thread_current();
-	struct list_elem* e;
-	for(e = list_begin(&cur->spt); e != list_end(&cur->spt); e = list_next(e)){
-		struct spte *target = list_entry (e, struct spte, spt_elem);
-/*		printf("targ %p\n", target->page_number);
-*/		pagedir_clear_page(cur->pagedir, target->page_number);
-		deallocate_frame(target->frame_number);
-		list_remove(e);
-	}
-}
\ No newline at end of file
+/* Looks up the page containing NUMBER in SPT. */
+static struct spte* spt_lookup(struct hash* spt, uint8_t* number){
+	struct spte key;
+	struct hash_elem* e;
+	key.page_number = pg_round_down(number);
+	e = hash_find(spt, &key.spt_elem);
+	return e != NULL ? hash_entry(e, struct spte, spt_elem) : NULL;
+}
+
+struct spte* find_page(uint8_t* number){
+	return spt_lookup(&thread_current()->spt, number);
+}
+
+/* Adds SPTE to the current thread's supplemental page table. */
+void spt_insert(struct spte* spte){
+	hash_insert(&thread_current()->spt, &spte->spt_elem);
+}
+
+/* Removes SPTE from the current thread's supplemental page table. */
+void spt_remove(struct spte* spte){
+	hash_delete(&thread_current()->spt, &spte->spt_elem);
+}
+
+/* Returns the page held in frame KPAGE, or a null pointer if
+   KPAGE is not in use as a frame. */
+struct spte* find_page_from_frame(uint8_t* kpage){
+	struct frame_table_entry* frame;
+	struct spte* found = NULL;
+	/* Lookups only need the frame table in shared mode. */
+	bool shared = !rwlock_held_by_current_thread(&frame_table_lock);
+	if(shared)
+		rwlock_acquire_read(&frame_table_lock);
+	frame = frame_lookup(kpage);
+	if(frame != NULL)
+		found = frame->mapped_page;
+	if(shared)
+		rwlock_release_read(&frame_table_lock);
+	return found;
+}
+
+static void spte_destroy(struct hash_elem* e, void *aux UNUSED){
+	struct spte *target = hash_entry(e, struct spte, spt_elem);
+	frame_wait_evicted(target);
+	pagedir_clear_page(target->pagedir, target->page_number);
+	release_frame(target);
+	swap_free(target);
+	spte_free(target);
+}
+
+void clear_spt(void){
+	hash_destroy(&thread_current()->spt, spte_destroy);
+}
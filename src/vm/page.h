@@ -1,6 +1,6 @@
 #ifndef PAGE_H
 #define PAGE_H
-#include <list.h>
+#include <hash.h>
 #include <inttypes.h>
 #include "threads/thread.h"
 #include "filesys/file.h"
@@ -11,18 +11,26 @@ struct spte {
   uint8_t* page_number;
   uint8_t* frame_number;
   int thread_id;
+  uint32_t* pagedir;           /* Owner's page directory. */
+  size_t swap_slot;            /* Swap slot holding the page, or SWAP_SLOT_NONE. */
   struct file* related_file;
   int offset;
   int read_bytes;
   int zero_bytes;
   bool writable;
       bool is_pinned;
+  bool evicting;               /* Being written out by evict()? */
 
-  struct list_elem spt_elem;
+  struct hash_elem spt_elem;   /* Element in the owner's SPT, keyed by page_number. */
 };
 
+void spt_init(void);
+bool spt_create(void);
+struct spte* spte_alloc(void);
+void spte_free(struct spte* spte);
 struct spte* find_page(uint8_t* number);
-void clear_spt();
-struct spte* find_page_from_frame(uint8_t* number);
-struct spte* find_page_from_spts(uint8_t* number);
+void spt_insert(struct spte* spte);
+void spt_remove(struct spte* spte);
+void clear_spt(void);
+struct spte* find_page_from_frame(uint8_t* kpage);
 #endif /* vm/page.h */
\ No newline at end of file
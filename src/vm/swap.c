@@ -1,90 +1,196 @@
 #include "vm/swap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
 #include "devices/block.h"
+#include "devices/timer.h"
 #include "vm/frame.h"
+#include "threads/palloc.h"
 #include "threads/synch.h"
-#include "devices/timer.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+
+/* Sectors per page-sized swap slot. */
+#define SECTORS_PER_SLOT (PGSIZE / BLOCK_SECTOR_SIZE)
+
+static struct block* swap_block;    /* Swap device, or null if none. */
+static struct bitmap* swap_slots;   /* Slots in use. */
+static struct lock swap_lock;       /* Protects swap_slots. */
 
-extern frame_table_lock;
-extern frame_table;
-struct lock swap_table_lock;
+/* Buffer for transferring a cluster of pages, whose frames are
+   not contiguous, in one request. */
+static uint8_t* cluster_buf;        /* SWAP_CLUSTER_MAX pages. */
+static struct lock cluster_lock;    /* Protects cluster_buf. */
 
-struct swap_sector swap_table[8192];
+/* Number of pages written to and read from swap, and the number
+   of block requests that took. */
+static long long swap_out_cnt;
+static long long swap_in_cnt;
+static long long swap_write_cnt;
+static long long swap_read_cnt;
+static int64_t swap_ns;             /* Time spent in swap I/O. */
 
+/* Sizes the slot allocator to the swap device.  Must run after
+   the block devices have been located. */
 void swap_table_init(){
-	for(int i=0; i<8192; i++){
-		swap_table[i].is_avail = true;
-	}
+	size_t slot_cnt = 0;
+	swap_block = block_get_role(BLOCK_SWAP);
+	if(swap_block != NULL)
+		slot_cnt = block_size(swap_block) / SECTORS_PER_SLOT;
+	swap_slots = bitmap_create(slot_cnt);
+	if(swap_slots == NULL)
+		PANIC("swap: out of memory");
+	cluster_buf = palloc_get_multiple(PAL_ASSERT, SWAP_CLUSTER_MAX);
+	lock_init(&swap_lock);
+	lock_init(&cluster_lock);
 }
 
-void swap_write(uint8_t* page_number, uint8_t* frame_number){
-	if(!lock_held_by_current_thread(&frame_table_lock)){
-		lock_acquire(&frame_table_lock);	
-	}
-	if(!lock_held_by_current_thread(&swap_table)){
-		lock_acquire(&swap_table);	
-	}
-	int pos = 0;
-	struct spte* page = find_page_from_frame(page_number);
-	
-	
-	page->related_file = NULL;
-
-	for(;pos<8192; pos+=8){
-		if(swap_table[pos].is_avail){
-			break;
-		}
+/* Allocates CNT contiguous swap slots and returns the first, or
+   BITMAP_ERROR if there is no such run. */
+static size_t alloc_slots(size_t cnt){
+	size_t slot;
+	lock_acquire(&swap_lock);
+	slot = bitmap_scan_and_flip(swap_slots, 0, cnt, false);
+	lock_release(&swap_lock);
+	return slot;
+}
+
+/* Writes the pages held in the CNT FRAMES to swap slots SLOT
+   onward in a single request, and records the slots in their
+   pages. */
+static void write_run(struct frame_table_entry** frames, size_t cnt, size_t slot){
+	size_t i;
+	if(cnt == 1)
+		block_write_multiple(swap_block, slot * SECTORS_PER_SLOT,
+		                     SECTORS_PER_SLOT, frames[0]->frame_number);
+	else{
+		lock_acquire(&cluster_lock);
+		for(i = 0; i < cnt; i++)
+			memcpy(cluster_buf + i * PGSIZE, frames[i]->frame_number, PGSIZE);
+		block_write_multiple(swap_block, slot * SECTORS_PER_SLOT,
+		                     cnt * SECTORS_PER_SLOT, cluster_buf);
+		lock_release(&cluster_lock);
 	}
-	for(int i=0; i<8; i++){
-		int offset = 512 * i;
-		swap_table[pos+i].page_number = page_number;
-		swap_table[pos+i].is_avail = false;
-		swap_table[pos+i].thread_id = page->thread_id;
-		block_write(block_get_role(BLOCK_SWAP), pos + i, page_number + offset);
+	for(i = 0; i < cnt; i++){
+		struct spte* page = frames[i]->mapped_page;
+		page->related_file = NULL;
+		page->swap_slot = slot + i;
 	}
-	if(lock_held_by_current_thread(&swap_table_lock))
-		lock_release(&swap_table_lock);
-	if(lock_held_by_current_thread(&frame_table_lock))
-		lock_release(&frame_table_lock);
+	swap_out_cnt += cnt;
+	swap_write_cnt++;
+}
 
+/* Writes the pages held in the CNT FRAMES, which are adjacent in
+   their address space and in order of address, to swap.  Puts
+   them in contiguous slots with as few requests as free space
+   allows, so that they can later be read back together. */
+void swap_write(struct frame_table_entry** frames, size_t cnt){
+	int64_t start = timer_ns();
+	while(cnt > 0){
+		size_t run = cnt;
+		size_t slot;
+		while((slot = alloc_slots(run)) == BITMAP_ERROR)
+			if(--run == 0)
+				PANIC("swap: out of slots");
+		write_run(frames, run, slot);
+		frames += run;
+		cnt -= run;
+	}
+	swap_ns += timer_ns() - start;
 }
 
+/* Reads PAGE from its swap slot into frame FRAME_NUMBER and frees
+   the slot.  A page that was never written to swap is zeroed.
+   PAGE must belong to the current process.  The pages that follow
+   PAGE in the address space and were written to the following
+   slots, as by a clustered swap_write(), are read in the same
+   request and mapped too, as long as free frames are available
+   for them without evicting. */
+void swap_read(struct spte* page, uint8_t* frame_number){
+	struct spte* next[SWAP_CLUSTER_MAX];
+	struct frame_table_entry* frames[SWAP_CLUSTER_MAX];
+	int64_t start;
+	size_t cnt = 1;
+	size_t i;
 
-void swap_read(uint8_t* page_number, uint8_t* frame_number){
-	if(!lock_held_by_current_thread(&frame_table_lock)){
-		lock_acquire(&frame_table_lock);	
+	if(page->swap_slot == SWAP_SLOT_NONE){
+		memset(frame_number, 0, PGSIZE);
+		return;
 	}
-	int pos = 0;
-	for(;pos<8192; pos+=8){
-		if(swap_table[pos].page_number == page_number){
+
+	start = timer_ns();
+	while(cnt < SWAP_CLUSTER_MAX){
+		struct spte* p = find_page(page->page_number + cnt * PGSIZE);
+		if(p == NULL || p->frame_number != NULL
+		   || p->swap_slot != page->swap_slot + cnt)
+			break;
+		frames[cnt] = try_allocate_frame(PAL_USER);
+		if(frames[cnt] == NULL)
 			break;
+		next[cnt] = p;
+		cnt++;
+	}
+
+	if(cnt == 1)
+		block_read_multiple(swap_block, page->swap_slot * SECTORS_PER_SLOT,
+		                    SECTORS_PER_SLOT, frame_number);
+	else{
+		lock_acquire(&cluster_lock);
+		block_read_multiple(swap_block, page->swap_slot * SECTORS_PER_SLOT,
+		                    cnt * SECTORS_PER_SLOT, cluster_buf);
+		memcpy(frame_number, cluster_buf, PGSIZE);
+		for(i = 1; i < cnt; i++)
+			memcpy(frames[i]->frame_number, cluster_buf + i * PGSIZE, PGSIZE);
+		lock_release(&cluster_lock);
+	}
+	swap_free(page);
+
+	/* Map the pages read ahead. */
+	for(i = 1; i < cnt; i++){
+		if(!pagedir_set_page(thread_current()->pagedir, next[i]->page_number,
+		                     frames[i]->frame_number, next[i]->writable)){
+			deallocate_frame(frames[i]->frame_number);
+			continue;
 		}
+		map_frame(frames[i], next[i]);
+		swap_free(next[i]);
 	}
-	if(pos==8192)
+	swap_in_cnt += cnt;
+	swap_read_cnt++;
+	swap_ns += timer_ns() - start;
+}
+
+/* Releases PAGE's swap slot, if it has one. */
+void swap_free(struct spte* page){
+	if(page->swap_slot == SWAP_SLOT_NONE)
 		return;
-	for(int i=0; i<8; i++){
-		int offset = 512 * i;
-		swap_table[pos+i].is_avail = true;
-		block_read(block_get_role(BLOCK_SWAP), pos+i, page_number +offset);
-	}
-	if(lock_held_by_current_thread(&frame_table_lock))
-		lock_release(&frame_table_lock);
+	lock_acquire(&swap_lock);
+	bitmap_reset(swap_slots, page->swap_slot);
+	lock_release(&swap_lock);
+	page->swap_slot = SWAP_SLOT_NONE;
+}
+
+void swap_print_stats(void){
+	long long pages = swap_out_cnt + swap_in_cnt;
+	printf("Swap: %lld pages out in %lld writes, %lld pages in in %lld reads, "
+	       "%lld pages/s\n", swap_out_cnt, swap_write_cnt,
+	       swap_in_cnt, swap_read_cnt,
+	       swap_ns > 0 ? pages * 1000000000 / swap_ns : 0);
+	printf("Swap: %zu of %zu slots in use\n",
+	       bitmap_count(swap_slots, 0, bitmap_size(swap_slots), true),
+	       bitmap_size(swap_slots));
 }
 
+/* Returns 1 if FRAME must be written to swap before it is
+   evicted: it is dirty, or it has no file to be reloaded from. */
 int is_swap(struct frame_table_entry* frame){
-	struct thread* thread = find_thread(frame->mapped_page->thread_id);
-	if (pagedir_is_dirty(thread->pagedir, frame->mapped_page->page_number)){
+	struct spte* page = frame->mapped_page;
+	if (page->related_file == NULL
+	    || pagedir_is_dirty(page->pagedir, page->page_number)){
 		return 1;
 	}
 	else{
 		return 0;
 	}
-	return 0;
-
 }
-
-void clear_swap_table(){
-	for(int i=0; i<8192; i++){
-		if(thread_tid()==swap_table[i].thread_id)
-			swap_table[i].is_avail = true;
-	}
-}
\ No newline at end of file
@@ -1,17 +1,23 @@
 #ifndef SWAP_H
 #define SWAP_H
 #include <inttypes.h>
+#include <stddef.h>
 #include "threads/thread.h"
+#include "vm/page.h"
 
+/* Value of spte's swap_slot when the page is not in swap. */
+#define SWAP_SLOT_NONE ((size_t) -1)
+
+/* Most pages written to or read from swap in one request. */
+#define SWAP_CLUSTER_MAX 8
+
+struct frame_table_entry;
 
-struct swap_sector {
-	uint8_t* page_number;
-	bool is_avail;
-	int thread_id;
-};
 void swap_table_init(void);
-void swap_write(uint8_t* page_number, uint8_t* frame_number);
-void swap_read(uint8_t* page_number, uint8_t* frame_number);
+void swap_write(struct frame_table_entry** frames, size_t cnt);
+void swap_read(struct spte* page, uint8_t* frame_number);
+void swap_free(struct spte* page);
 int is_swap(struct frame_table_entry* frame);
+void swap_print_stats(void);
 
 #endif /* vm/swap.h */